@@ -0,0 +1,46 @@
+
+CONFIG += c++17
+CONFIG += console
+CONFIG += release
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = pcosynchrobench
+
+# qmake CONFIG+=pcosynchro_inline .. builds the benchmarks against the
+# inline configuration, see src/pcoinline.h
+pcosynchro_inline {
+    DEFINES += PCOSYNCHRO_INLINE
+    TARGET = pcosynchrobench_inline
+}
+
+unix {
+    LIBS += -lpthread
+}
+
+LIBS += -lbenchmark
+
+SOURCES += \
+        ../src/pcomanager.cpp \
+        ../src/pcothread.cpp \
+        ../src/pcomutex.cpp \
+        ../src/pcosemaphore.cpp \
+        ../src/pcoconditionvariable.cpp \
+        ../src/pcotimerservice.cpp \
+        ../src/pcohazardpointer.cpp \
+        ../src/pcoepochreclaimer.cpp \
+        main.cpp
+
+HEADERS += \
+    ../src/pcoinline.h \
+    ../src/pcomanager.h \
+    ../src/pcomanager_inline.h \
+    ../src/pcothread.h \
+    ../src/pcothread_inline.h \
+    ../src/pcomutex.h \
+    ../src/pcomutex_inline.h \
+    ../src/pcosemaphore.h \
+    ../src/pcoconditionvariable.h \
+    ../src/pcotimerservice.h \
+    ../src/pcohazardpointer.h \
+    ../src/pcoepochreclaimer.h
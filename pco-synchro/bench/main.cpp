@@ -0,0 +1,179 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/pcomanager.h"
+#include "../src/pcomutex.h"
+#include "../src/pcothread.h"
+#include "../src/pcotimerservice.h"
+#include "../src/pcohazardpointer.h"
+#include "../src/pcoepochreclaimer.h"
+
+#ifdef PCOSYNCHRO_INLINE
+static const char *configuration = "inline";
+#else
+static const char *configuration = "out-of-line";
+#endif
+
+// The following benchmarks measure the call overhead of the fast paths.
+// Compare the results of pcosynchrobench and pcosynchrobench_inline.
+
+static void BM_GetInstance(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PcoManager::getInstance());
+    }
+    state.SetLabel(configuration);
+}
+
+BENCHMARK(BM_GetInstance);
+
+static void BM_GetMode(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PcoManager::getInstance()->getMode());
+    }
+    state.SetLabel(configuration);
+}
+
+BENCHMARK(BM_GetMode);
+
+static void BM_RandomSleepDisabled(benchmark::State& state) {
+    for (auto _ : state) {
+        PcoManager::getInstance()->randomSleep();
+    }
+    state.SetLabel(configuration);
+}
+
+BENCHMARK(BM_RandomSleepDisabled);
+
+static void BM_MutexLockUnlock(benchmark::State& state) {
+    PcoMutex mutex;
+    for (auto _ : state) {
+        mutex.lock();
+        mutex.unlock();
+    }
+    state.SetLabel(configuration);
+}
+
+BENCHMARK(BM_MutexLockUnlock);
+
+static void BM_Usleep0(benchmark::State& state) {
+    for (auto _ : state) {
+        PcoThread::usleep(0);
+    }
+    state.SetLabel(configuration);
+}
+
+BENCHMARK(BM_Usleep0);
+
+
+// Delay far enough in the future so that no timer expires during a benchmark
+static const uint64_t farDelay = 3600ull * 1000 * 1000;
+
+static void BM_TimerScheduleCancel(benchmark::State& state) {
+    // Cost of a schedule() followed by a cancel(), with state.range(0)
+    // other timers pending in the wheel
+    PcoTimerService service;
+    std::vector<PcoTimerService::TimerId> pending;
+    pending.reserve(static_cast<size_t>(state.range(0)));
+    for (int64_t i = 0; i < state.range(0); i++) {
+        pending.push_back(service.schedule(farDelay + static_cast<uint64_t>(i) * 1000, [](){}));
+    }
+    for (auto _ : state) {
+        auto id = service.schedule(farDelay / 2, [](){});
+        benchmark::DoNotOptimize(service.cancel(id));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TimerScheduleCancel)->Arg(0)->Arg(1000)->Arg(1000000)->Unit(benchmark::kNanosecond);
+
+static void BM_TimerSchedule1M(benchmark::State& state) {
+    // Time to fill the wheel with one million timers spread over an hour,
+    // and to cancel all of them
+    const int64_t nbTimers = 1000000;
+    PcoTimerService service;
+    std::vector<PcoTimerService::TimerId> ids(static_cast<size_t>(nbTimers));
+    for (auto _ : state) {
+        for (int64_t i = 0; i < nbTimers; i++) {
+            ids[static_cast<size_t>(i)] = service.schedule(static_cast<uint64_t>(i) * 3600, [](){});
+        }
+        for (auto id : ids) {
+            service.cancel(id);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * nbTimers);
+}
+
+BENCHMARK(BM_TimerSchedule1M)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Memory reclamation: cost of retiring a node, including its deletion once
+// the threshold is reached, and cost of the read side protection
+
+struct BenchNode {
+    uint64_t value;
+};
+
+static PcoHazardPointerDomain hazardDomain;
+
+static void BM_HazardRetire(benchmark::State& state) {
+    for (auto _ : state) {
+        hazardDomain.retire(new BenchNode{0});
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_HazardRetire)->Threads(1)->Threads(4);
+
+static void BM_HazardProtect(benchmark::State& state) {
+    static std::atomic<BenchNode *> shared{new BenchNode{0}};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hazardDomain.protect(shared)->value);
+        hazardDomain.clear();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_HazardProtect)->Threads(1)->Threads(4);
+
+static PcoEpochReclaimer epochReclaimer;
+
+static void BM_EpochRetire(benchmark::State& state) {
+    for (auto _ : state) {
+        epochReclaimer.retire(new BenchNode{0});
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_EpochRetire)->Threads(1)->Threads(4);
+
+static void BM_EpochEnterLeave(benchmark::State& state) {
+    static std::atomic<BenchNode *> shared{new BenchNode{0}};
+    for (auto _ : state) {
+        PcoEpochReclaimer::Guard guard(epochReclaimer);
+        benchmark::DoNotOptimize(shared.load()->value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_EpochEnterLeave)->Threads(1)->Threads(4);
+
+BENCHMARK_MAIN();
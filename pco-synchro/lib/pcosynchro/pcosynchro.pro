@@ -5,23 +5,43 @@ CONFIG += staticlib
 
 CONFIG += c++17
 
+# Optional configurations, see src/pcoinline.h
+# qmake CONFIG+=pcosynchro_inline CONFIG+=pcosynchro_lto ..
+pcosynchro_inline {
+    DEFINES += PCOSYNCHRO_INLINE
+}
+pcosynchro_lto {
+    CONFIG += ltcg
+}
+
 SOURCES += \
     ../../src/pcoconditionvariable.cpp \
+    ../../src/pcoepochreclaimer.cpp \
+    ../../src/pcohazardpointer.cpp \
     ../../src/pcohoaremonitor.cpp \
     ../../src/pcologger.cpp \
     ../../src/pcomanager.cpp \
     ../../src/pcomutex.cpp \
     ../../src/pcosemaphore.cpp \
-    ../../src/pcothread.cpp
+    ../../src/pcothread.cpp \
+    ../../src/pcotimerservice.cpp
 
 HEADERS += \
     ../../src/pcoconditionvariable.h \
+    ../../src/pcoepochreclaimer.h \
+    ../../src/pcofuture.h \
+    ../../src/pcohazardpointer.h \
     ../../src/pcohoaremonitor.h \
+    ../../src/pcoinline.h \
     ../../src/pcologger.h \
     ../../src/pcomanager.h \
+    ../../src/pcomanager_inline.h \
     ../../src/pcomutex.h \
+    ../../src/pcomutex_inline.h \
     ../../src/pcosemaphore.h \
-    ../../src/pcothread.h
+    ../../src/pcothread.h \
+    ../../src/pcothread_inline.h \
+    ../../src/pcotimerservice.h
 
 # Default rules for deployment.
 unix {
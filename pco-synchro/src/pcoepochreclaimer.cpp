@@ -0,0 +1,203 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#include <algorithm>
+
+#include "pcoepochreclaimer.h"
+
+namespace {
+
+/// Source of the reclaimer identifiers, never reused
+std::atomic<uint64_t> nextReclaimerId{1};
+
+///
+/// \brief The CachedRecord struct
+///
+/// Associates a reclaimer to the record owned by the thread.
+///
+struct CachedRecord
+{
+    uint64_t reclaimerId;
+    void *record;
+};
+
+/// The records owned by the calling thread, one per reclaimer used
+thread_local std::vector<CachedRecord> cachedRecords;
+
+} // namespace
+
+
+PcoEpochReclaimer::PcoEpochReclaimer(size_t retireThreshold) :
+    m_id(nextReclaimerId++), m_retireThreshold(std::max<size_t>(retireThreshold, 1))
+{
+    PcoManager::getInstance()->addThreadObserver(this);
+}
+
+PcoEpochReclaimer::~PcoEpochReclaimer()
+{
+    PcoManager::getInstance()->removeThreadObserver(this);
+    releaseThread();
+    Record *record = m_records.load();
+    while (record != nullptr) {
+        for (auto &retired : record->retired) {
+            retired.deleter(retired.pointer);
+        }
+        Record *next = record->next;
+        delete record;
+        record = next;
+    }
+    for (auto &retired : m_orphans) {
+        retired.deleter(retired.pointer);
+    }
+}
+
+void PcoEpochReclaimer::enter()
+{
+    Record *own = record();
+    if (own->nesting++ == 0) {
+        // Announcing an epoch that has just become old is harmless: it only
+        // prevents the epoch from advancing further
+        own->state.store((m_epoch.load() << 1) | 1);
+    }
+}
+
+void PcoEpochReclaimer::leave()
+{
+    Record *own = record();
+    if (--own->nesting == 0) {
+        own->state.store(0);
+    }
+}
+
+void PcoEpochReclaimer::retire(void *pointer, void (*deleter)(void *))
+{
+    Record *own = record();
+    own->retired.push_back({pointer, deleter, m_epoch.load()});
+    m_nbRetired ++;
+    if (own->retired.size() >= m_retireThreshold) {
+        tryAdvance();
+    }
+}
+
+bool PcoEpochReclaimer::tryAdvance()
+{
+    uint64_t epoch = m_epoch.load();
+    bool advanced = true;
+    for (Record *record = m_records.load(); record != nullptr; record = record->next) {
+        uint64_t state = record->state.load();
+        if ((state & 1) != 0 && (state >> 1) != epoch) {
+            advanced = false;
+            break;
+        }
+    }
+    if (advanced) {
+        advanced = m_epoch.compare_exchange_strong(epoch, epoch + 1);
+        epoch = m_epoch.load();
+    }
+
+    reclaim(record()->retired, epoch);
+    std::unique_lock<std::mutex> lock(m_orphansMutex, std::try_to_lock);
+    if (lock.owns_lock() && !m_orphans.empty()) {
+        reclaim(m_orphans, epoch);
+    }
+    return advanced;
+}
+
+void PcoEpochReclaimer::reclaim(std::vector<PcoRetiredPointer> &retired, uint64_t epoch)
+{
+    // A node retired during epoch e may still be accessed by a thread that
+    // entered during epoch e, which prevents the global epoch from passing
+    // e + 1. Once the global epoch reaches e + 2, nobody can access it.
+    auto kept = std::partition(retired.begin(), retired.end(), [epoch](const PcoRetiredPointer &node){
+        return node.tag + 2 > epoch;
+    });
+    for (auto it = kept; it != retired.end(); it++) {
+        it->deleter(it->pointer);
+    }
+    m_nbRetired -= static_cast<size_t>(retired.end() - kept);
+    retired.erase(kept, retired.end());
+}
+
+void PcoEpochReclaimer::releaseThread()
+{
+    auto cached = std::find_if(cachedRecords.begin(), cachedRecords.end(), [this](const CachedRecord &entry){
+        return entry.reclaimerId == m_id;
+    });
+    if (cached == cachedRecords.end()) {
+        return;
+    }
+    Record *own = static_cast<Record *>(cached->record);
+    cachedRecords.erase(cached);
+
+    own->nesting = 0;
+    own->state.store(0);
+    {
+        std::lock_guard<std::mutex> guard(m_orphansMutex);
+        m_orphans.insert(m_orphans.end(), own->retired.begin(), own->retired.end());
+    }
+    own->retired.clear();
+    own->active.store(false);
+}
+
+size_t PcoEpochReclaimer::nbRetired() const
+{
+    return m_nbRetired.load();
+}
+
+uint64_t PcoEpochReclaimer::epoch() const
+{
+    return m_epoch.load();
+}
+
+void PcoEpochReclaimer::threadStarted(PcoThread * /*thread*/)
+{
+}
+
+void PcoEpochReclaimer::threadFinished(PcoThread * /*thread*/)
+{
+    releaseThread();
+}
+
+PcoEpochReclaimer::Record *PcoEpochReclaimer::record()
+{
+    for (auto &entry : cachedRecords) {
+        if (entry.reclaimerId == m_id) {
+            return static_cast<Record *>(entry.record);
+        }
+    }
+
+    // First try to reuse the record of a finished thread
+    Record *own = nullptr;
+    for (Record *record = m_records.load(); record != nullptr; record = record->next) {
+        bool expected = false;
+        if (!record->active.load() && record->active.compare_exchange_strong(expected, true)) {
+            own = record;
+            break;
+        }
+    }
+    if (own == nullptr) {
+        own = new Record();
+        Record *head = m_records.load();
+        do {
+            own->next = head;
+        } while (!m_records.compare_exchange_weak(head, own));
+    }
+    cachedRecords.push_back({m_id, own});
+    return own;
+}
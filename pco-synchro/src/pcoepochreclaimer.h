@@ -0,0 +1,215 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOEPOCHRECLAIMER_H
+#define PCOEPOCHRECLAIMER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "pcomanager.h"
+#include "pcohazardpointer.h"
+
+///
+/// \brief The PcoEpochReclaimer class
+///
+/// This class implements the epoch based memory reclamation scheme, used to
+/// safely delete the nodes of lock-free structures.
+///
+/// A thread accesses the structure between enter() and leave(), or within
+/// the scope of a Guard. A node removed from the structure is given to
+/// retire() and is deleted once every thread has left the critical sections
+/// it was in when the node was retired. This is cheaper than hazard pointers
+/// for reads, but a thread staying in a critical section delays all the
+/// reclamations.
+///
+/// As for PcoHazardPointerDomain, the record of a PcoThread is released
+/// automatically when it finishes. A thread that is not a PcoThread has to
+/// call releaseThread() itself before finishing.
+///
+class PcoEpochReclaimer : public PcoThreadObserver
+{
+public:
+
+    ///
+    /// \brief The Guard class
+    ///
+    /// Enters a critical section on construction, and leaves it on destruction.
+    ///
+    class Guard
+    {
+    public:
+
+        /// Enters the critical section of the reclaimer
+        explicit Guard(PcoEpochReclaimer &reclaimer) : m_reclaimer(reclaimer) { m_reclaimer.enter(); }
+
+        /// Leaves the critical section
+        ~Guard() { m_reclaimer.leave(); }
+
+        /// No copy
+        Guard (const Guard&) = delete;
+
+        /// No copy
+        Guard& operator= ( const Guard & ) = delete;
+
+    private:
+
+        /// The reclaimer of the critical section
+        PcoEpochReclaimer &m_reclaimer;
+    };
+
+    ///
+    /// \brief PcoEpochReclaimer constructor
+    /// \param retireThreshold Number of nodes retired by a thread before it
+    ///        tries to advance the epoch and to reclaim them
+    ///
+    explicit PcoEpochReclaimer(size_t retireThreshold = 64);
+
+    /// No copy
+    PcoEpochReclaimer (const PcoEpochReclaimer&) = delete;
+
+    /// No copy
+    PcoEpochReclaimer (const PcoEpochReclaimer&&) = delete;
+
+    /// No copy
+    PcoEpochReclaimer& operator= ( const PcoEpochReclaimer & ) = delete;
+
+    ///
+    /// \brief Destructor
+    ///
+    /// Deletes all the retired nodes. No thread should use the reclaimer anymore.
+    ///
+    ~PcoEpochReclaimer() override;
+
+    ///
+    /// \brief enters a critical section
+    ///
+    /// The critical sections can be nested.
+    ///
+    void enter();
+
+    ///
+    /// \brief leaves a critical section
+    ///
+    void leave();
+
+    ///
+    /// \brief retires a node, that will be deleted once no thread can access it
+    /// \param pointer The node, allocated with new
+    ///
+    template<typename T>
+    void retire(T *pointer)
+    {
+        retire(pointer, [](void *p){ delete static_cast<T *>(p); });
+    }
+
+    ///
+    /// \brief retires a node, that will be deleted once no thread can access it
+    /// \param pointer The node
+    /// \param deleter The function used to delete the node
+    ///
+    void retire(void *pointer, void (*deleter)(void *));
+
+    ///
+    /// \brief tries to advance the global epoch, and deletes the nodes of
+    ///        the calling thread that are not accessible anymore
+    /// \return true if the epoch has been advanced
+    ///
+    bool tryAdvance();
+
+    ///
+    /// \brief releases the record of the calling thread
+    ///
+    /// Its retired nodes are handed to the other threads. Called automatically
+    /// for a PcoThread.
+    ///
+    void releaseThread();
+
+    ///
+    /// \brief gets the number of retired nodes not yet deleted
+    /// \return The number of nodes waiting to be deleted
+    ///
+    size_t nbRetired() const;
+
+    ///
+    /// \brief gets the global epoch
+    /// \return The current global epoch
+    ///
+    uint64_t epoch() const;
+
+    /// Acquires nothing, the record is acquired lazily
+    void threadStarted(PcoThread *thread) override;
+
+    /// Releases the record of the finishing thread
+    void threadFinished(PcoThread *thread) override;
+
+protected:
+
+    ///
+    /// \brief The Record struct
+    ///
+    /// The state and the retired nodes of one thread.
+    ///
+    struct Record {
+        /// The epoch observed when entering, shifted by one, the lowest bit
+        /// indicating the thread is within a critical section
+        std::atomic<uint64_t> state{0};
+        /// Indicates if a thread owns the record
+        std::atomic<bool> active{true};
+        /// Nesting level of the critical sections
+        unsigned int nesting{0};
+        /// The nodes retired by the thread owning the record, tagged with
+        /// their retirement epoch
+        std::vector<PcoRetiredPointer> retired;
+        /// The next record of the reclaimer
+        Record *next{nullptr};
+    };
+
+    /// Gets the record of the calling thread, acquiring one if necessary
+    Record *record();
+
+    /// Deletes the nodes retired at least two epochs ago
+    void reclaim(std::vector<PcoRetiredPointer> &retired, uint64_t epoch);
+
+    /// Identifies the reclaimer in the thread local caches
+    const uint64_t m_id;
+
+    /// Number of retired nodes triggering a tryAdvance()
+    const size_t m_retireThreshold;
+
+    /// The global epoch
+    std::atomic<uint64_t> m_epoch{0};
+
+    /// The list of records, never shrinking until destruction
+    std::atomic<Record *> m_records{nullptr};
+
+    /// Number of retired nodes not yet deleted
+    std::atomic<size_t> m_nbRetired{0};
+
+    /// Nodes retired by threads that have finished
+    std::vector<PcoRetiredPointer> m_orphans;
+
+    /// Mutex protecting m_orphans
+    std::mutex m_orphansMutex;
+};
+
+#endif // PCOEPOCHRECLAIMER_H
@@ -0,0 +1,635 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOFUTURE_H
+#define PCOFUTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "pcomanager.h"
+
+template<typename T>
+class PcoFuture;
+
+template<typename T>
+class PcoPromise;
+
+///
+/// \brief The PcoFutureCancelled class
+///
+/// The exception thrown by PcoFuture::get() when the future has been
+/// cancelled before getting its value.
+///
+class PcoFutureCancelled : public std::runtime_error
+{
+public:
+
+    /// Default constructor
+    PcoFutureCancelled() : std::runtime_error("The PcoFuture has been cancelled") {}
+};
+
+///
+/// \brief The PcoFutureState class
+///
+/// The state shared by a PcoPromise and its PcoFuture objects. It is not
+/// meant to be used directly.
+///
+/// A thread blocked while waiting for the state is counted by the PcoManager
+/// as a blocked thread, as for the other synchronization objects.
+///
+template<typename T>
+class PcoFutureState
+{
+public:
+
+    /// The type actually stored, as void cannot be stored
+    using ValueType = std::conditional_t<std::is_void_v<T>, bool, T>;
+
+    /// A function run when the state becomes ready
+    using Continuation = std::function<void(PcoFutureState<T> &)>;
+
+    ///
+    /// \brief sets the value, making the state ready
+    /// \param args The arguments used to build the value, nothing for void
+    /// \return true if the value was set, false if the state was already ready
+    ///
+    template<typename... Args>
+    bool setValue(Args&&... args)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_ready) {
+            return false;
+        }
+        if constexpr (std::is_void_v<T>) {
+            m_value.emplace(true);
+        }
+        else {
+            m_value.emplace(std::forward<Args>(args)...);
+        }
+        complete(lock);
+        return true;
+    }
+
+    ///
+    /// \brief sets an exception, making the state ready
+    /// \param exception The exception to rethrow from get()
+    /// \return true if the exception was set, false if the state was already ready
+    ///
+    bool setException(std::exception_ptr exception)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_ready) {
+            return false;
+        }
+        m_exception = exception;
+        complete(lock);
+        return true;
+    }
+
+    ///
+    /// \brief cancels the state, if it is not ready yet
+    /// \return true if the state was cancelled, false if it was already ready
+    ///
+    /// The cancellation is propagated to the states this one depends on.
+    ///
+    bool cancel()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_ready) {
+            return false;
+        }
+        m_cancelled = true;
+        m_exception = std::make_exception_ptr(PcoFutureCancelled());
+        auto callbacks = std::move(m_cancelCallbacks);
+        complete(lock);
+        for (auto &callback : callbacks) {
+            callback();
+        }
+        return true;
+    }
+
+    /// Blocks the caller until the state is ready
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_ready) {
+            PcoManager::getInstance()->addWaitingThread();
+            m_condition.wait(lock, [this](){ return m_ready; });
+            PcoManager::getInstance()->removeWaitingThread();
+        }
+    }
+
+    ///
+    /// \brief Blocks the caller until the state is ready, for at most a certain duration
+    /// \param useconds The maximum number of microseconds to wait
+    /// \return true if the state is ready
+    ///
+    bool waitFor(uint64_t useconds)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_ready) {
+            PcoManager::getInstance()->addWaitingThread();
+            m_condition.wait_for(lock, std::chrono::microseconds(useconds), [this](){ return m_ready; });
+            PcoManager::getInstance()->removeWaitingThread();
+        }
+        return m_ready;
+    }
+
+    /// Indicates if the state is ready
+    bool isReady()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_ready;
+    }
+
+    /// Indicates if the state has been cancelled. Cheap enough to be polled
+    bool isCancelled() const
+    {
+        return m_cancelled.load(std::memory_order_relaxed);
+    }
+
+    ///
+    /// \brief adds a function to run when the state becomes ready
+    /// \param continuation The function, run immediately if the state is ready
+    ///
+    /// The function is run by the thread making the state ready.
+    ///
+    void addContinuation(Continuation continuation)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_ready) {
+            m_continuations.push_back(std::move(continuation));
+            return;
+        }
+        lock.unlock();
+        continuation(*this);
+    }
+
+    ///
+    /// \brief adds a function to run if the state is cancelled
+    /// \param callback The function, forgotten once the state is ready
+    ///
+    void addCancelCallback(std::function<void()> callback)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        if (!m_ready) {
+            m_cancelCallbacks.push_back(std::move(callback));
+        }
+    }
+
+    /// The exception of a ready state, nullptr if it holds a value
+    std::exception_ptr exception() const
+    {
+        return m_exception;
+    }
+
+    /// The value of a ready state
+    const ValueType &value() const
+    {
+        return *m_value;
+    }
+
+protected:
+
+    /// Makes the state ready, and runs the continuations after unlocking
+    void complete(std::unique_lock<std::mutex> &lock)
+    {
+        m_ready = true;
+        auto continuations = std::move(m_continuations);
+        // A ready state cannot be cancelled, and the callbacks may hold
+        // references to other states
+        m_cancelCallbacks.clear();
+        lock.unlock();
+        m_condition.notify_all();
+        for (auto &continuation : continuations) {
+            continuation(*this);
+        }
+    }
+
+    /// Mutex protecting the state
+    std::mutex m_mutex;
+
+    /// Condition used to block the waiting threads
+    std::condition_variable m_condition;
+
+    /// Indicates if a value or an exception has been set
+    bool m_ready{false};
+
+    /// Indicates if the state has been cancelled
+    std::atomic<bool> m_cancelled{false};
+
+    /// The value, once set
+    std::optional<ValueType> m_value;
+
+    /// The exception, once set
+    std::exception_ptr m_exception;
+
+    /// The functions to run when the state becomes ready
+    std::vector<Continuation> m_continuations;
+
+    /// The functions to run if the state is cancelled
+    std::vector<std::function<void()>> m_cancelCallbacks;
+};
+
+///
+/// \brief The PcoContinuationResult struct
+///
+/// Computes the type returned by a continuation of a PcoFuture<T>.
+///
+template<typename T, typename F>
+struct PcoContinuationResult
+{
+    /// A continuation of a PcoFuture<T> gets the value
+    using type = std::invoke_result_t<F, const T &>;
+};
+
+///
+/// \brief The PcoContinuationResult struct
+///
+/// Computes the type returned by a continuation of a PcoFuture<void>.
+///
+template<typename F>
+struct PcoContinuationResult<void, F>
+{
+    /// A continuation of a PcoFuture<void> gets no argument
+    using type = std::invoke_result_t<F>;
+};
+
+///
+/// \brief The PcoWhenAnyResult struct
+///
+/// The value of the future returned by whenAny().
+///
+template<typename T>
+struct PcoWhenAnyResult
+{
+    /// The index of the first future that became ready
+    size_t index;
+
+    /// All the futures given to whenAny()
+    std::vector<PcoFuture<T>> futures;
+};
+
+///
+/// \brief The PcoFuture class
+///
+/// This class represents a value that will be available later, set by a
+/// PcoPromise, typically from another PcoThread.
+///
+/// A PcoFuture can be copied, all the copies sharing the same state, and
+/// get() can be called several times. A function to run once the value is
+/// available can be chained with then(), and futures can be combined with
+/// whenAll() and whenAny().
+///
+/// A future can be cancelled. The waiting threads are then released, get()
+/// throws PcoFutureCancelled, and the thread computing the value can notice
+/// it thanks to PcoPromise::isCancelled() and stop early.
+///
+template<typename T>
+class PcoFuture
+{
+public:
+
+    /// Builds an invalid future, to be assigned later
+    PcoFuture() = default;
+
+    ///
+    /// \brief Indicates if the future is associated to a promise
+    /// \return true if the future can be used
+    ///
+    bool isValid() const
+    {
+        return m_state != nullptr;
+    }
+
+    ///
+    /// \brief gets the value, waiting for it if necessary
+    /// \return The value set by the promise
+    ///
+    /// If the promise has set an exception, it is rethrown. If the future
+    /// has been cancelled, PcoFutureCancelled is thrown.
+    ///
+    T get() const
+    {
+        m_state->wait();
+        if (m_state->exception()) {
+            std::rethrow_exception(m_state->exception());
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return m_state->value();
+        }
+    }
+
+    ///
+    /// \brief Blocks the caller until the value is available
+    ///
+    /// While blocked, the caller is counted as a blocked thread by the PcoManager.
+    ///
+    void wait() const
+    {
+        m_state->wait();
+    }
+
+    ///
+    /// \brief Blocks the caller until the value is available, for at most a certain duration
+    /// \param useconds The maximum number of microseconds to wait
+    /// \return true if the value is available
+    ///
+    bool waitFor(uint64_t useconds) const
+    {
+        return m_state->waitFor(useconds);
+    }
+
+    ///
+    /// \brief Indicates if the value is available
+    /// \return true if get() would not block
+    ///
+    bool isReady() const
+    {
+        return m_state->isReady();
+    }
+
+    ///
+    /// \brief cancels the future
+    /// \return true if the future was cancelled, false if it was already ready
+    ///
+    /// The cancellation is shared by all the copies of the future, and is
+    /// propagated to the futures it depends on (through then(), whenAll()
+    /// and whenAny()).
+    ///
+    bool cancel() const
+    {
+        return m_state->cancel();
+    }
+
+    ///
+    /// \brief Indicates if the future has been cancelled
+    /// \return true if cancel() succeeded on this future or on one it depends on
+    ///
+    bool isCancelled() const
+    {
+        return m_state->isCancelled();
+    }
+
+    ///
+    /// \brief chains a function to run once the value is available
+    /// \param func The function, getting the value (nothing for PcoFuture<void>)
+    /// \return A future holding the result of the function
+    ///
+    /// The function is run by the thread setting the value, or immediately
+    /// if the value is already available. If this future holds an exception
+    /// or is cancelled, the function is not run and the returned future
+    /// gets the same exception or cancellation. An exception thrown by the
+    /// function is stored in the returned future.
+    ///
+    template<typename F>
+    auto then(F func) const -> PcoFuture<typename PcoContinuationResult<T, F>::type>
+    {
+        using R = typename PcoContinuationResult<T, F>::type;
+        auto next = std::make_shared<PcoFutureState<R>>();
+        std::weak_ptr<PcoFutureState<T>> source = m_state;
+        next->addCancelCallback([source](){
+            if (auto state = source.lock()) {
+                state->cancel();
+            }
+        });
+        m_state->addContinuation([next, func = std::move(func)](PcoFutureState<T> &state) mutable {
+            if (state.isCancelled()) {
+                next->cancel();
+                return;
+            }
+            if (state.exception()) {
+                next->setException(state.exception());
+                return;
+            }
+            try {
+                if constexpr (std::is_void_v<T> && std::is_void_v<R>) {
+                    std::invoke(func);
+                    next->setValue();
+                }
+                else if constexpr (std::is_void_v<T>) {
+                    next->setValue(std::invoke(func));
+                }
+                else if constexpr (std::is_void_v<R>) {
+                    std::invoke(func, state.value());
+                    next->setValue();
+                }
+                else {
+                    next->setValue(std::invoke(func, state.value()));
+                }
+            }
+            catch (...) {
+                next->setException(std::current_exception());
+            }
+        });
+        return PcoFuture<R>(next);
+    }
+
+protected:
+
+    /// Builds a future from its state
+    explicit PcoFuture(std::shared_ptr<PcoFutureState<T>> state) : m_state(std::move(state)) {}
+
+    /// The state shared with the promise
+    std::shared_ptr<PcoFutureState<T>> m_state;
+
+    /// PcoPromise is a friend, to build the future
+    friend PcoPromise<T>;
+
+    /// The other PcoFuture are friends, for then()
+    template<typename U>
+    friend class PcoFuture;
+
+    /// whenAll() is a friend, to access the state
+    template<typename U>
+    friend PcoFuture<std::vector<PcoFuture<U>>> whenAll(std::vector<PcoFuture<U>> futures);
+
+    /// whenAny() is a friend, to access the state
+    template<typename U>
+    friend PcoFuture<PcoWhenAnyResult<U>> whenAny(std::vector<PcoFuture<U>> futures);
+};
+
+///
+/// \brief The PcoPromise class
+///
+/// This class allows to set the value of a PcoFuture. A promise can be
+/// copied, for instance to be passed by value to a PcoThread, all the
+/// copies sharing the same state.
+///
+/// If the last copy of a promise is destroyed without having set a value,
+/// the future gets a std::future_error with the broken_promise code.
+///
+template<typename T>
+class PcoPromise
+{
+public:
+
+    /// Builds a promise with a new shared state
+    PcoPromise() : m_owner(std::make_shared<Owner>()) {}
+
+    ///
+    /// \brief gets a future associated to the promise
+    /// \return A future getting the value set by the promise
+    ///
+    PcoFuture<T> getFuture() const
+    {
+        return PcoFuture<T>(m_owner->state);
+    }
+
+    ///
+    /// \brief sets the value of the future
+    /// \param args The arguments used to build the value, nothing for void
+    /// \return true if the value was set, false if a value, an exception or
+    ///         a cancellation was already set
+    ///
+    template<typename... Args>
+    bool setValue(Args&&... args) const
+    {
+        return m_owner->state->setValue(std::forward<Args>(args)...);
+    }
+
+    ///
+    /// \brief sets an exception, thrown by the get() of the future
+    /// \param exception The exception
+    /// \return true if the exception was set, false if the future was already ready
+    ///
+    bool setException(std::exception_ptr exception) const
+    {
+        return m_owner->state->setException(exception);
+    }
+
+    ///
+    /// \brief Indicates if the future has been cancelled
+    /// \return true if the future has been cancelled
+    ///
+    /// The thread computing the value can call this function regularly to
+    /// stop as soon as the value is not needed anymore.
+    ///
+    bool isCancelled() const
+    {
+        return m_owner->state->isCancelled();
+    }
+
+protected:
+
+    ///
+    /// \brief The Owner struct
+    ///
+    /// Shared by the copies of the promise, it breaks the promise when the
+    /// last copy is destroyed.
+    ///
+    struct Owner {
+        /// The state shared with the futures
+        std::shared_ptr<PcoFutureState<T>> state{std::make_shared<PcoFutureState<T>>()};
+
+        /// Sets the broken_promise error if no value has been set
+        ~Owner()
+        {
+            state->setException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+    };
+
+    /// The owner of the shared state
+    std::shared_ptr<Owner> m_owner;
+};
+
+///
+/// \brief combines futures into a future ready when all of them are ready
+/// \param futures The futures to combine
+/// \return A future holding the futures, all ready
+///
+/// The returned future does not hold exceptions: the exceptions of the
+/// combined futures are thrown by their own get(). Cancelling the returned
+/// future cancels all the combined futures.
+///
+template<typename T>
+PcoFuture<std::vector<PcoFuture<T>>> whenAll(std::vector<PcoFuture<T>> futures)
+{
+    using Result = std::vector<PcoFuture<T>>;
+
+    // Shared by the continuations of the combined futures
+    struct Context {
+        Result futures;
+        std::atomic<size_t> nbRemaining;
+    };
+
+    auto result = std::make_shared<PcoFutureState<Result>>();
+    if (futures.empty()) {
+        result->setValue(Result());
+        return PcoFuture<Result>(result);
+    }
+
+    auto context = std::make_shared<Context>();
+    context->nbRemaining = futures.size();
+    context->futures = std::move(futures);
+    result->addCancelCallback([context](){
+        for (auto &future : context->futures) {
+            future.cancel();
+        }
+    });
+    for (auto &future : context->futures) {
+        future.m_state->addContinuation([result, context](PcoFutureState<T> &) {
+            if (--context->nbRemaining == 0) {
+                result->setValue(context->futures);
+            }
+        });
+    }
+    return PcoFuture<Result>(result);
+}
+
+///
+/// \brief combines futures into a future ready when one of them is ready
+/// \param futures The futures to combine, at least one
+/// \return A future holding the index of the first ready future, and all
+///         the futures
+///
+/// The other futures are not cancelled automatically: for an early exit,
+/// the caller cancels them once the result is known. Cancelling the returned
+/// future cancels all the combined futures.
+///
+template<typename T>
+PcoFuture<PcoWhenAnyResult<T>> whenAny(std::vector<PcoFuture<T>> futures)
+{
+    auto result = std::make_shared<PcoFutureState<PcoWhenAnyResult<T>>>();
+    auto context = std::make_shared<std::vector<PcoFuture<T>>>(std::move(futures));
+    result->addCancelCallback([context](){
+        for (auto &future : *context) {
+            future.cancel();
+        }
+    });
+    for (size_t index = 0; index < context->size(); index++) {
+        (*context)[index].m_state->addContinuation([result, context, index](PcoFutureState<T> &) {
+            result->setValue(PcoWhenAnyResult<T>{index, *context});
+        });
+    }
+    return PcoFuture<PcoWhenAnyResult<T>>(result);
+}
+
+#endif // PCOFUTURE_H
@@ -0,0 +1,191 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+
+#include "pcohazardpointer.h"
+
+namespace {
+
+/// Source of the domain identifiers, never reused
+std::atomic<uint64_t> nextDomainId{1};
+
+///
+/// \brief The CachedRecord struct
+///
+/// Associates a domain to the record owned by the thread.
+///
+struct CachedRecord
+{
+    uint64_t domainId;
+    void *record;
+};
+
+/// The records owned by the calling thread, one per domain used
+thread_local std::vector<CachedRecord> cachedRecords;
+
+} // namespace
+
+
+PcoHazardPointerDomain::PcoHazardPointerDomain(size_t retireThreshold) :
+    m_id(nextDomainId++), m_retireThreshold(std::max<size_t>(retireThreshold, 1))
+{
+    PcoManager::getInstance()->addThreadObserver(this);
+}
+
+PcoHazardPointerDomain::~PcoHazardPointerDomain()
+{
+    PcoManager::getInstance()->removeThreadObserver(this);
+    releaseThread();
+    Record *record = m_records.load();
+    while (record != nullptr) {
+        for (auto &retired : record->retired) {
+            retired.deleter(retired.pointer);
+        }
+        Record *next = record->next;
+        delete record;
+        record = next;
+    }
+    for (auto &retired : m_orphans) {
+        retired.deleter(retired.pointer);
+    }
+}
+
+void PcoHazardPointerDomain::clear(size_t index)
+{
+    hazardOf(index).store(nullptr);
+}
+
+void PcoHazardPointerDomain::retire(void *pointer, void (*deleter)(void *))
+{
+    Record *own = record();
+    own->retired.push_back({pointer, deleter, 0});
+    m_nbRetired ++;
+    if (own->retired.size() >= m_retireThreshold) {
+        scan();
+    }
+}
+
+void PcoHazardPointerDomain::scan()
+{
+    reclaim(record()->retired);
+
+    // The nodes of the finished threads are reclaimed by whoever is available
+    std::unique_lock<std::mutex> lock(m_orphansMutex, std::try_to_lock);
+    if (lock.owns_lock() && !m_orphans.empty()) {
+        reclaim(m_orphans);
+    }
+}
+
+void PcoHazardPointerDomain::reclaim(std::vector<PcoRetiredPointer> &retired)
+{
+    std::vector<void *> hazards;
+    for (Record *record = m_records.load(); record != nullptr; record = record->next) {
+        for (auto &hazard : record->hazards) {
+            void *pointer = hazard.load();
+            if (pointer != nullptr) {
+                hazards.push_back(pointer);
+            }
+        }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    auto kept = std::partition(retired.begin(), retired.end(), [&hazards](const PcoRetiredPointer &node){
+        return std::binary_search(hazards.begin(), hazards.end(), node.pointer);
+    });
+    for (auto it = kept; it != retired.end(); it++) {
+        it->deleter(it->pointer);
+    }
+    m_nbRetired -= static_cast<size_t>(retired.end() - kept);
+    retired.erase(kept, retired.end());
+}
+
+void PcoHazardPointerDomain::releaseThread()
+{
+    auto cached = std::find_if(cachedRecords.begin(), cachedRecords.end(), [this](const CachedRecord &entry){
+        return entry.domainId == m_id;
+    });
+    if (cached == cachedRecords.end()) {
+        return;
+    }
+    Record *own = static_cast<Record *>(cached->record);
+    cachedRecords.erase(cached);
+
+    for (auto &hazard : own->hazards) {
+        hazard.store(nullptr);
+    }
+    {
+        std::lock_guard<std::mutex> guard(m_orphansMutex);
+        m_orphans.insert(m_orphans.end(), own->retired.begin(), own->retired.end());
+    }
+    own->retired.clear();
+    own->active.store(false);
+}
+
+size_t PcoHazardPointerDomain::nbRetired() const
+{
+    return m_nbRetired.load();
+}
+
+void PcoHazardPointerDomain::threadStarted(PcoThread * /*thread*/)
+{
+}
+
+void PcoHazardPointerDomain::threadFinished(PcoThread * /*thread*/)
+{
+    releaseThread();
+}
+
+PcoHazardPointerDomain::Record *PcoHazardPointerDomain::record()
+{
+    for (auto &entry : cachedRecords) {
+        if (entry.domainId == m_id) {
+            return static_cast<Record *>(entry.record);
+        }
+    }
+
+    // First try to reuse the record of a finished thread
+    Record *own = nullptr;
+    for (Record *record = m_records.load(); record != nullptr; record = record->next) {
+        bool expected = false;
+        if (!record->active.load() && record->active.compare_exchange_strong(expected, true)) {
+            own = record;
+            break;
+        }
+    }
+    if (own == nullptr) {
+        own = new Record();
+        for (auto &hazard : own->hazards) {
+            hazard.store(nullptr);
+        }
+        Record *head = m_records.load();
+        do {
+            own->next = head;
+        } while (!m_records.compare_exchange_weak(head, own));
+    }
+    cachedRecords.push_back({m_id, own});
+    return own;
+}
+
+std::atomic<void *> &PcoHazardPointerDomain::hazardOf(size_t index)
+{
+    assert(index < NB_HAZARDS);
+    return record()->hazards[index];
+}
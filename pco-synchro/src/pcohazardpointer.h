@@ -0,0 +1,214 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOHAZARDPOINTER_H
+#define PCOHAZARDPOINTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "pcomanager.h"
+
+///
+/// \brief The PcoRetiredPointer struct
+///
+/// A pointer removed from a lock-free structure, waiting to be deleted, and
+/// the function able to delete it.
+///
+struct PcoRetiredPointer
+{
+    /// The pointer to delete
+    void *pointer;
+
+    /// The function deleting the pointer
+    void (*deleter)(void *);
+
+    /// A tag set by the reclaimer, for instance the epoch of the retirement
+    uint64_t tag;
+};
+
+///
+/// \brief The PcoHazardPointerDomain class
+///
+/// This class implements the hazard pointers memory reclamation scheme, used
+/// to safely delete the nodes of lock-free structures.
+///
+/// A thread announces the pointers it is about to dereference with protect(),
+/// and a node removed from the structure is given to retire() instead of
+/// being deleted. A retired node is deleted only once no thread protects it.
+///
+/// Each thread gets a record of NB_HAZARDS hazard pointers, acquired the first
+/// time it uses the domain. The domain observes the PcoThread objects, so the
+/// record of a PcoThread is released automatically when it finishes, and the
+/// nodes it retired are reclaimed by the other threads. A thread that is not a
+/// PcoThread has to call releaseThread() itself before finishing.
+///
+class PcoHazardPointerDomain : public PcoThreadObserver
+{
+public:
+
+    /// Number of hazard pointers available per thread
+    static constexpr size_t NB_HAZARDS = 4;
+
+    ///
+    /// \brief PcoHazardPointerDomain constructor
+    /// \param retireThreshold Number of nodes retired by a thread before it
+    ///        tries to reclaim them
+    ///
+    explicit PcoHazardPointerDomain(size_t retireThreshold = 64);
+
+    /// No copy
+    PcoHazardPointerDomain (const PcoHazardPointerDomain&) = delete;
+
+    /// No copy
+    PcoHazardPointerDomain (const PcoHazardPointerDomain&&) = delete;
+
+    /// No copy
+    PcoHazardPointerDomain& operator= ( const PcoHazardPointerDomain & ) = delete;
+
+    ///
+    /// \brief Destructor
+    ///
+    /// Deletes all the retired nodes. No thread should use the domain anymore.
+    ///
+    ~PcoHazardPointerDomain() override;
+
+    ///
+    /// \brief protects a pointer read from a shared location
+    /// \param source The shared location
+    /// \param index The index of the hazard pointer to use, below NB_HAZARDS
+    /// \return The pointer read, which can be dereferenced until clear()
+    ///
+    /// The pointer is read again until it is stable, so that it cannot have
+    /// been retired before being protected.
+    ///
+    template<typename T>
+    T *protect(const std::atomic<T *> &source, size_t index = 0)
+    {
+        std::atomic<void *> &hazard = hazardOf(index);
+        T *pointer = source.load();
+        while (true) {
+            hazard.store(pointer);
+            T *check = source.load();
+            if (check == pointer) {
+                return pointer;
+            }
+            pointer = check;
+        }
+    }
+
+    ///
+    /// \brief clears a hazard pointer
+    /// \param index The index of the hazard pointer to clear
+    ///
+    void clear(size_t index = 0);
+
+    ///
+    /// \brief retires a node, that will be deleted once no thread protects it
+    /// \param pointer The node, allocated with new
+    ///
+    template<typename T>
+    void retire(T *pointer)
+    {
+        retire(pointer, [](void *p){ delete static_cast<T *>(p); });
+    }
+
+    ///
+    /// \brief retires a node, that will be deleted once no thread protects it
+    /// \param pointer The node
+    /// \param deleter The function used to delete the node
+    ///
+    void retire(void *pointer, void (*deleter)(void *));
+
+    ///
+    /// \brief deletes the nodes retired by the calling thread that are not
+    ///        protected anymore
+    ///
+    void scan();
+
+    ///
+    /// \brief releases the record of the calling thread
+    ///
+    /// Its hazard pointers are cleared and its retired nodes are handed to
+    /// the other threads. Called automatically for a PcoThread.
+    ///
+    void releaseThread();
+
+    ///
+    /// \brief gets the number of retired nodes not yet deleted
+    /// \return The number of nodes waiting to be deleted
+    ///
+    size_t nbRetired() const;
+
+    /// Acquires nothing, the record is acquired lazily
+    void threadStarted(PcoThread *thread) override;
+
+    /// Releases the record of the finishing thread
+    void threadFinished(PcoThread *thread) override;
+
+protected:
+
+    ///
+    /// \brief The Record struct
+    ///
+    /// The hazard pointers and the retired nodes of one thread.
+    ///
+    struct Record {
+        /// The hazard pointers of the thread
+        std::atomic<void *> hazards[NB_HAZARDS];
+        /// Indicates if a thread owns the record
+        std::atomic<bool> active{true};
+        /// The nodes retired by the thread owning the record
+        std::vector<PcoRetiredPointer> retired;
+        /// The next record of the domain
+        Record *next{nullptr};
+    };
+
+    /// Gets the record of the calling thread, acquiring one if necessary
+    Record *record();
+
+    /// Gets a hazard pointer of the calling thread
+    std::atomic<void *> &hazardOf(size_t index);
+
+    /// Deletes the nodes of a list that are not protected, keeping the others
+    void reclaim(std::vector<PcoRetiredPointer> &retired);
+
+    /// Identifies the domain in the thread local caches
+    const uint64_t m_id;
+
+    /// Number of retired nodes triggering a scan()
+    const size_t m_retireThreshold;
+
+    /// The list of records, never shrinking until destruction
+    std::atomic<Record *> m_records{nullptr};
+
+    /// Number of retired nodes not yet deleted
+    std::atomic<size_t> m_nbRetired{0};
+
+    /// Nodes retired by threads that have finished
+    std::vector<PcoRetiredPointer> m_orphans;
+
+    /// Mutex protecting m_orphans
+    std::mutex m_orphansMutex;
+};
+
+#endif // PCOHAZARDPOINTER_H
@@ -0,0 +1,42 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOINLINE_H
+#define PCOINLINE_H
+
+///
+/// \file pcoinline.h
+///
+/// When PCOSYNCHRO_INLINE is defined, the fast paths of the library
+/// (PcoManager::getInstance(), PcoManager::randomSleep() when no sleep is
+/// configured, PcoManager::getMode(), PcoMutex::lock(), PcoMutex::unlock(),
+/// PcoThread::usleep()) are defined inline in the headers, so that they can
+/// be inlined into the loops of the calling code. The cold paths (thread
+/// registry, random sleeps, watchdog) stay in the library.
+///
+/// The library and the code using it have to be compiled with the same
+/// value of PCOSYNCHRO_INLINE. The CMake target propagates it automatically.
+///
+#ifdef PCOSYNCHRO_INLINE
+#define PCO_INLINE inline
+#else
+#define PCO_INLINE
+#endif
+
+#endif // PCOINLINE_H
@@ -27,11 +27,9 @@
 #include "pcothread.h"
 #include "pcosemaphore.h"
 
-PcoManager *PcoManager::getInstance()
-{
-    static PcoManager pcoManager;
-    return &pcoManager;
-}
+#ifndef PCOSYNCHRO_INLINE
+#include "pcomanager_inline.h"
+#endif
 
 PcoManager::PcoManager()
 {
@@ -54,10 +52,15 @@ void PcoManager::setMaxSleepDuration(unsigned int useconds, EventType eventType)
 {
     m_sleepMutex.lock();
     m_usecondsMap[eventType] = useconds;
+    bool sleepEnabled = false;
+    for (const auto &entry : m_usecondsMap) {
+        sleepEnabled = sleepEnabled || (entry.second > 0);
+    }
+    m_sleepEnabled = sleepEnabled;
     m_sleepMutex.unlock();
 }
 
-void PcoManager::randomSleep(EventType eventType)
+void PcoManager::doRandomSleep(EventType eventType)
 {
     unsigned int useconds;
     m_sleepMutex.lock();
@@ -81,12 +84,18 @@ void PcoManager::registerThread(PcoThread *thread)
 {
     m_mutex.lock();
     m_runningThreads[thread->getId()] = thread;
+    for (auto observer : m_threadObservers) {
+        observer->threadStarted(thread);
+    }
     m_mutex.unlock();
 }
 
 void PcoManager::unregisterThread(PcoThread *thread)
 {
     m_mutex.lock();
+    for (auto observer : m_threadObservers) {
+        observer->threadFinished(thread);
+    }
     m_runningThreads.erase(thread->getId());
     m_mutex.unlock();
 }
@@ -113,14 +122,6 @@ void PcoManager::unregisterSemaphore(PcoSemaphore *semaphore)
     m_mutex.unlock();
 }
 
-PcoManager::Mode PcoManager::getMode()
-{
-    m_mutex.lock();
-    auto result = m_mode;
-    m_mutex.unlock();
-    return result;
-}
-
 void PcoManager::setNormalMode()
 {
     m_mutex.lock();
@@ -187,3 +188,25 @@ void PcoManager::setWatchDog(PcoWatchDog *watchDog)
 {
     m_watchDog = watchDog;
 }
+
+void PcoManager::addThreadObserver(PcoThreadObserver *observer)
+{
+    m_mutex.lock();
+    m_threadObservers.push_back(observer);
+    m_mutex.unlock();
+}
+
+void PcoManager::removeThreadObserver(PcoThreadObserver *observer)
+{
+    m_mutex.lock();
+    auto it = m_threadObservers.begin();
+    while (it != m_threadObservers.end()) {
+        if (*it == observer) {
+            m_threadObservers.erase(it);
+            m_mutex.unlock();
+            return;
+        }
+        it++;
+    }
+    m_mutex.unlock();
+}
@@ -20,17 +20,23 @@
 #ifndef PCOCOMMON_H
 #define PCOCOMMON_H
 
+#include <atomic>
 #include <map>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include "pcoinline.h"
+
 
 class PcoThread;
 class PcoMutex;
 class PcoSemaphore;
 class PcoConditionVariable;
 
+template<typename T>
+class PcoFutureState;
+
 ///
 /// \brief The PcoWatchDog class
 ///
@@ -54,6 +60,33 @@ public:
     virtual void trigger(int nbBlocked) = 0;
 };
 
+///
+/// \brief The PcoThreadObserver class
+///
+/// This abstract class has to be derived and added to the PcoManager.
+/// Then its functions are called whenever a PcoThread starts or finishes.
+/// Both functions are called from within the thread itself, so the
+/// observer can manage thread local data.
+class PcoThreadObserver
+{
+public:
+
+    /// Empty virtual destructor
+    virtual ~PcoThreadObserver() = default;
+
+    ///
+    /// \brief threadStarted
+    /// \param thread The thread that just started
+    ///
+    virtual void threadStarted(PcoThread *thread) = 0;
+
+    ///
+    /// \brief threadFinished
+    /// \param thread The thread that is about to finish
+    ///
+    virtual void threadFinished(PcoThread *thread) = 0;
+};
+
 ///
 /// \brief The PcoManager class
 ///
@@ -105,6 +138,9 @@ public:
     /// This method is called by the various synchronization objects, letting
     /// them pass the kind of event, depending on their class.
     ///
+    /// As long as no sleeping time has been set, this method returns
+    /// immediately.
+    ///
     void randomSleep(EventType eventType = EventType::Standard);
 
     ///
@@ -133,6 +169,19 @@ public:
     ///
     void setWatchDog(PcoWatchDog *watchDog);
 
+    ///
+    /// \brief adds a thread observer
+    /// \param observer An observer that will be notified whenever a PcoThread
+    ///        starts or finishes
+    ///
+    void addThreadObserver(PcoThreadObserver *observer);
+
+    ///
+    /// \brief removes a thread observer
+    /// \param observer An observer previously added with addThreadObserver()
+    ///
+    void removeThreadObserver(PcoThreadObserver *observer);
+
     ///
     /// \brief The Mode of execution for semaphores
     ///
@@ -216,6 +265,18 @@ protected:
     /// has been waken up.
     void removeWaitingThread();
 
+    ///
+    /// \brief Let the calling thread sleeps for a random period
+    /// \param eventType The event type used to get the correct maximum time
+    ///
+    /// The slow path of randomSleep(), called when at least one sleeping
+    /// time is set.
+    ///
+    void doRandomSleep(EventType eventType);
+
+    /// Indicates if at least one sleeping time is greater than 0
+    std::atomic<bool> m_sleepEnabled{false};
+
     /// Map of sleeping times per type of event
     std::map<EventType, unsigned int> m_usecondsMap;
 
@@ -234,6 +295,9 @@ protected:
     /// A watchdog called when a thread blocks on a synchronization object
     PcoWatchDog *m_watchDog{nullptr};
 
+    /// The observers notified when a thread starts or finishes
+    std::vector<PcoThreadObserver *> m_threadObservers;
+
     /// A vector of PcoSemaphore that are monitored to detect deadlocks
     std::vector<PcoSemaphore *> m_semaphores;
 
@@ -258,7 +322,7 @@ protected:
 
     /// \brief the execution mode of semaphores
     /// By default, we use the normal mode to have a coherent behavior
-    Mode m_mode{Mode::Normal};
+    std::atomic<Mode> m_mode{Mode::Normal};
 
 
     /// PcoThread is a friend just to help
@@ -273,7 +337,15 @@ protected:
     /// PcoConditionVariable is a friend just to help
     friend PcoConditionVariable;
 
+    /// PcoFutureState is a friend just to help
+    template<typename T>
+    friend class PcoFutureState;
+
 };
 
 
+#ifdef PCOSYNCHRO_INLINE
+#include "pcomanager_inline.h"
+#endif
+
 #endif // PCOCOMMON_H
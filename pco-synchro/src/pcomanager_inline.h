@@ -0,0 +1,45 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOMANAGER_INLINE_H
+#define PCOMANAGER_INLINE_H
+
+// Fast paths of PcoManager, see pcoinline.h
+
+#include "pcomanager.h"
+
+PCO_INLINE PcoManager *PcoManager::getInstance()
+{
+    static PcoManager pcoManager;
+    return &pcoManager;
+}
+
+PCO_INLINE void PcoManager::randomSleep(EventType eventType)
+{
+    if (m_sleepEnabled.load(std::memory_order_relaxed)) {
+        doRandomSleep(eventType);
+    }
+}
+
+PCO_INLINE PcoManager::Mode PcoManager::getMode()
+{
+    return m_mode.load();
+}
+
+#endif // PCOMANAGER_INLINE_H
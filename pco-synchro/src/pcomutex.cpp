@@ -20,31 +20,46 @@
 #include "pcomutex.h"
 #include "pcomanager.h"
 
+#ifndef PCOSYNCHRO_INLINE
+#include "pcomutex_inline.h"
+#endif
 
-PcoMutex::PcoMutex(PcoMutex::RecursionMode recursionMode) : m_recursionMode(recursionMode)
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+
+PcoMutex::PcoMutex(PcoMutex::RecursionMode recursionMode, PcoMutex::PriorityProtocol protocol) :
+    m_recursionMode(recursionMode), m_protocol(PriorityProtocol::NoInheritance)
 {
+#if !defined(WIN32) && defined(_POSIX_THREAD_PRIO_INHERIT) && _POSIX_THREAD_PRIO_INHERIT > 0
+    if (protocol == PriorityProtocol::PriorityInheritance) {
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        bool ok = pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT) == 0;
+        if (ok && m_recursionMode == RecursionMode::Recursive) {
+            ok = pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE) == 0;
+        }
+        if (ok && pthread_mutex_init(&m_inheritanceMutex, &attributes) == 0) {
+            m_protocol = PriorityProtocol::PriorityInheritance;
+        }
+        pthread_mutexattr_destroy(&attributes);
+    }
+#else
+    (void) protocol;
+#endif
 }
 
-void PcoMutex::lock()
+PcoMutex::~PcoMutex()
 {
-    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexLock);
-    if (m_recursionMode == RecursionMode::Recursive) {
-        m_recursiveMutex.lock();
+#ifndef WIN32
+    if (m_protocol == PriorityProtocol::PriorityInheritance) {
+        pthread_mutex_destroy(&m_inheritanceMutex);
     }
-    else {
-        m_mutex.lock();
-    }
-    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexLock);
+#endif
 }
 
-void PcoMutex::unlock()
+PcoMutex::PriorityProtocol PcoMutex::priorityProtocol() const
 {
-    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexUnlock);
-    if (m_recursionMode == RecursionMode::Recursive) {
-        m_recursiveMutex.unlock();
-    }
-    else {
-        m_mutex.unlock();
-    }
-    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexUnlock);
+    return m_protocol;
 }
@@ -22,6 +22,12 @@
 
 #include <mutex>
 
+#include "pcoinline.h"
+
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
 ///
 /// \brief The PcoMutex class
 ///
@@ -29,6 +35,11 @@
 /// The mutex can be recursive or not, and the lock() and unlock() methods
 /// can add random sleeps before and after the effective lock() and unlock().
 ///
+/// On POSIX systems the mutex can also use the priority inheritance protocol
+/// (PTHREAD_PRIO_INHERIT): a thread holding the mutex then runs at the
+/// priority of the highest priority thread blocked on it, which bounds the
+/// priority inversion suffered by real-time threads.
+///
 class PcoMutex
 {
 public:
@@ -39,12 +50,24 @@ public:
     ///
     enum RecursionMode { Recursive, NonRecursive };
 
+    ///
+    /// \brief The PriorityProtocol enum
+    ///
+    /// NoInheritance is the standard behavior. PriorityInheritance asks for a
+    /// mutex that lends the priority of the blocked threads to its owner.
+    /// If the platform does not support it, the mutex silently falls back to
+    /// NoInheritance.
+    ///
+    enum PriorityProtocol { NoInheritance, PriorityInheritance };
+
 
     ///
     /// \brief PcoMutex constructor
     /// \param recursionMode Indicates if the mutex is recursive or not
+    /// \param protocol Indicates if the mutex uses priority inheritance or not
     ///
-    PcoMutex(RecursionMode recursionMode = RecursionMode::NonRecursive);
+    PcoMutex(RecursionMode recursionMode = RecursionMode::NonRecursive,
+             PriorityProtocol protocol = PriorityProtocol::NoInheritance);
 
     /// No copy
     PcoMutex (const PcoMutex&) = delete;
@@ -55,8 +78,8 @@ public:
     /// No copy
     PcoMutex& operator= ( const PcoMutex & ) = delete;
 
-    /// Default destructor
-    ~PcoMutex() = default;
+    /// Destructor, releasing the priority inheritance mutex if any
+    ~PcoMutex();
 
     ///
     /// \brief Locks the mutex
@@ -78,6 +101,12 @@ public:
     ///
     void unlock();
 
+    ///
+    /// \brief gets the priority protocol effectively used by the mutex
+    /// \return PriorityInheritance if the mutex lends priorities, NoInheritance else
+    ///
+    PriorityProtocol priorityProtocol() const;
+
 protected:
 
     /// A standard mutex, when initialized as a non-recursive mutex
@@ -88,6 +117,18 @@ protected:
 
     /// Indicates if the mutex is recursive or not (not recursive by default)
     const RecursionMode m_recursionMode;
+
+    /// The priority protocol effectively used by the mutex
+    PriorityProtocol m_protocol;
+
+#ifndef WIN32
+    /// A POSIX mutex, when initialized with the priority inheritance protocol
+    pthread_mutex_t m_inheritanceMutex;
+#endif
 };
 
+#ifdef PCOSYNCHRO_INLINE
+#include "pcomutex_inline.h"
+#endif
+
 #endif // PCOMUTEX_H
@@ -0,0 +1,64 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOMUTEX_INLINE_H
+#define PCOMUTEX_INLINE_H
+
+// Fast paths of PcoMutex, see pcoinline.h
+
+#include "pcomutex.h"
+#include "pcomanager.h"
+
+PCO_INLINE void PcoMutex::lock()
+{
+    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexLock);
+#ifndef WIN32
+    if (m_protocol == PriorityProtocol::PriorityInheritance) {
+        pthread_mutex_lock(&m_inheritanceMutex);
+    }
+    else
+#endif
+    if (m_recursionMode == RecursionMode::Recursive) {
+        m_recursiveMutex.lock();
+    }
+    else {
+        m_mutex.lock();
+    }
+    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexLock);
+}
+
+PCO_INLINE void PcoMutex::unlock()
+{
+    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexUnlock);
+#ifndef WIN32
+    if (m_protocol == PriorityProtocol::PriorityInheritance) {
+        pthread_mutex_unlock(&m_inheritanceMutex);
+    }
+    else
+#endif
+    if (m_recursionMode == RecursionMode::Recursive) {
+        m_recursiveMutex.unlock();
+    }
+    else {
+        m_mutex.unlock();
+    }
+    PcoManager::getInstance()->randomSleep(PcoManager::EventType::MutexUnlock);
+}
+
+#endif // PCOMUTEX_INLINE_H
@@ -22,8 +22,33 @@
 #include "pcosemaphore.h"
 #include "pcomanager.h"
 
+#ifndef WIN32
+#include <pthread.h>
+#endif
 
-PcoSemaphore::PcoSemaphore(unsigned int n, bool monitor) : m_value(static_cast<int>(n)), m_monitor(monitor)
+namespace {
+
+///
+/// \brief gets the scheduling priority of the calling thread
+/// \return The sched_priority of the thread, 0 if not available
+///
+int currentThreadPriority()
+{
+#ifndef WIN32
+    int policy;
+    sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+        return param.sched_priority;
+    }
+#endif
+    return 0;
+}
+
+} // namespace
+
+
+PcoSemaphore::PcoSemaphore(unsigned int n, bool monitor, QueueOrder order) :
+    m_order(order), m_value(static_cast<int>(n)), m_monitor(monitor)
 {
     if (m_monitor) {
         PcoManager::getInstance()->registerSemaphore(this);
@@ -40,7 +65,7 @@ PcoSemaphore::~PcoSemaphore()
         std::cout << "A PcoSemaphore should not be deleted if a thread is waiting on it" << std::endl;
     }
     while (!m_waitingCondition.empty()) {
-        m_waitingCondition.front()->notify_one();
+        m_waitingCondition.top().condition->notify_one();
         m_waitingCondition.pop();
     }
 }
@@ -56,7 +81,8 @@ void PcoSemaphore::acquire()
         m_value --;
         if (m_value < 0) {
             std::condition_variable *variable = new std::condition_variable();
-            m_waitingCondition.emplace(variable);
+            int priority = (m_order == QueueOrder::Priority) ? currentThreadPriority() : 0;
+            m_waitingCondition.push({priority, m_nbTickets++, variable});
             if (m_monitor) {
                 PcoManager::getInstance()->addWaitingThread();
             }
@@ -75,7 +101,7 @@ void PcoSemaphore::release()
         std::unique_lock<std::mutex> acquire(m_mutex);
         m_value ++;
         if (m_value <= 0) {
-            m_waitingCondition.front()->notify_one();
+            m_waitingCondition.top().condition->notify_one();
             m_waitingCondition.pop();
             if (m_monitor) {
                 PcoManager::getInstance()->removeWaitingThread();
@@ -23,6 +23,8 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <vector>
+#include <cstdint>
 
 class PcoManager;
 
@@ -32,20 +34,42 @@ class PcoManager;
 /// This class offers a strong semaphore, with a waiting queue managed in
 /// FIFO order. (A weak semaphore does not have a FIFO queue).
 ///
+/// The waiting queue can also be ordered by thread priority, in which case
+/// the thread with the highest scheduling priority is released first, and
+/// threads of equal priority are released in FIFO order.
+///
 class PcoSemaphore
 {
 public:
 
+    ///
+    /// \brief The QueueOrder enum
+    ///
+    /// Defines how the blocked threads are released.
+    ///
+    enum class QueueOrder {
+        /// The first blocked thread is the first released
+        Fifo,
+        /// The blocked thread with the highest priority is the first released
+        Priority
+    };
+
     ///
     /// \brief PcoSemaphore
     /// \param n The initial value of the semaphore, a positive integer
     /// \param monitor Indicates if the blocked thread list has to be monitored
+    /// \param order The order in which the blocked threads are released
     ///
     /// The second parameter allows to monitor the status of the waiting list.
     /// If yes, then a monitoring object (interacting with the PcoManager)
     /// is noticed whenever a thread blocks on this semaphore.
     ///
-    PcoSemaphore(unsigned int n = 0, bool monitor = true);
+    /// With QueueOrder::Priority the priority of a thread is its scheduling
+    /// priority (sched_priority) at the time it calls acquire(). Threads
+    /// scheduled with SCHED_OTHER all have priority 0 and are thus served in
+    /// FIFO order.
+    ///
+    PcoSemaphore(unsigned int n = 0, bool monitor = true, QueueOrder order = QueueOrder::Fifo);
 
     /// No copy
     PcoSemaphore (const PcoSemaphore&) = delete;
@@ -66,7 +90,8 @@ public:
     /// than 0, the caller is blocked and is put in the waiting queue.
     /// It can continue when a release() allows it to continue.
     ///
-    /// The waiting queue is FIFO.
+    /// The waiting queue is FIFO, or ordered by priority if the semaphore
+    /// has been built with QueueOrder::Priority.
     ///
     void acquire();
 
@@ -81,8 +106,37 @@ public:
 
 protected:
 
+    ///
+    /// \brief The WaitingThread struct
+    ///
+    /// An entry of the waiting queue. The ticket keeps the FIFO order between
+    /// threads of the same priority.
+    ///
+    struct WaitingThread {
+        /// The priority of the blocked thread
+        int priority;
+        /// The arrival order of the blocked thread
+        uint64_t ticket;
+        /// The condition variable the thread is blocked on
+        std::condition_variable *condition;
+
+        /// Orders the entries so that the top of the queue is the next to release
+        bool operator<(const WaitingThread &other) const {
+            if (priority != other.priority) {
+                return priority < other.priority;
+            }
+            return ticket > other.ticket;
+        }
+    };
+
     /// A queue of condition variables for the waiting queue
-    std::queue<std::condition_variable*> m_waitingCondition;
+    std::priority_queue<WaitingThread, std::vector<WaitingThread>> m_waitingCondition;
+
+    /// The number of threads that already entered the waiting queue
+    uint64_t m_nbTickets{0};
+
+    /// The order in which the blocked threads are released
+    const QueueOrder m_order;
 
     /// An internal mutex to protect the semaphore value
     std::mutex m_mutex;
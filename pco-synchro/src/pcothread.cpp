@@ -21,12 +21,9 @@
 
 #include "pcothread.h"
 
-using namespace std::chrono_literals;
-
-void PcoThread::usleep(uint64_t useconds)
-{
-    std::this_thread::sleep_for(1us * useconds);
-}
+#ifndef PCOSYNCHRO_INLINE
+#include "pcothread_inline.h"
+#endif
 
 std::thread::id PcoThread::getId()
 {
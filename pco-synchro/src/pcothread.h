@@ -169,4 +169,8 @@ protected:
     friend PcoManager;
 };
 
+#ifdef PCOSYNCHRO_INLINE
+#include "pcothread_inline.h"
+#endif
+
 #endif // PCOTHREAD_H
@@ -0,0 +1,34 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOTHREAD_INLINE_H
+#define PCOTHREAD_INLINE_H
+
+// Fast paths of PcoThread, see pcoinline.h
+
+#include <chrono>
+
+#include "pcothread.h"
+
+PCO_INLINE void PcoThread::usleep(uint64_t useconds)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(1) * useconds);
+}
+
+#endif // PCOTHREAD_INLINE_H
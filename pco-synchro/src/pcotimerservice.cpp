@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#include "pcotimerservice.h"
+#include "pcosemaphore.h"
+
+#include <algorithm>
+
+PcoTimerService *PcoTimerService::getInstance()
+{
+    static PcoTimerService timerService;
+    return &timerService;
+}
+
+PcoTimerService::PcoTimerService(uint64_t tickUseconds) :
+    m_tick(tickUseconds > 0 ? tickUseconds : 1),
+    m_start(std::chrono::steady_clock::now())
+{
+    m_thread = std::thread(&PcoTimerService::run, this);
+}
+
+PcoTimerService::~PcoTimerService()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_one();
+    m_thread.join();
+}
+
+PcoTimerService::TimerId PcoTimerService::schedule(uint64_t useconds, std::function<void()> callback)
+{
+    return addTimer(useconds, 0, std::move(callback));
+}
+
+PcoTimerService::TimerId PcoTimerService::schedulePeriodic(uint64_t useconds, std::function<void()> callback)
+{
+    return addTimer(useconds, useconds, std::move(callback));
+}
+
+PcoTimerService::TimerId PcoTimerService::releaseAfter(uint64_t useconds, PcoSemaphore *semaphore)
+{
+    return addTimer(useconds, 0, [semaphore](){ semaphore->release(); });
+}
+
+void PcoTimerService::sleep(uint64_t useconds)
+{
+    // Not monitored: a sleeping thread is not blocked on a synchronization
+    PcoSemaphore wakeUp(0, false);
+    releaseAfter(useconds, &wakeUp);
+    wakeUp.acquire();
+}
+
+size_t PcoTimerService::nbPendingTimers()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_nbPending;
+}
+
+bool PcoTimerService::cancel(TimerId id)
+{
+    uint32_t index = static_cast<uint32_t>(id & 0xFFFFFFFF);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (index == 0 || index > m_pool.size()) {
+        return false;
+    }
+    Timer &timer = m_pool[index - 1];
+    if (timer.generation != generation || !timer.linked) {
+        return false;
+    }
+    unlink(&timer);
+    release(index - 1);
+    return true;
+}
+
+PcoTimerService::TimerId PcoTimerService::addTimer(uint64_t useconds, uint64_t periodUseconds, std::function<void()> callback)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_nbPending == 0) {
+        // The wheel is empty, so it can directly jump to the current tick
+        m_currentTick = std::max(nowTick(), m_currentTick);
+    }
+    uint32_t index;
+    if (m_freeNodes.empty()) {
+        index = static_cast<uint32_t>(m_pool.size());
+        m_pool.emplace_back();
+        m_pool.back().index = index;
+    }
+    else {
+        index = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    }
+    Timer &timer = m_pool[index];
+    // The current tick is partially elapsed, so the timer expires one tick
+    // later, at the end of the tick in which the delay ends
+    timer.expiry = std::max(nowTick(), m_currentTick) + toTicks(useconds) + 1;
+    timer.period = periodUseconds > 0 ? std::max<uint64_t>(toTicks(periodUseconds), 1) : 0;
+    timer.callback = std::move(callback);
+    insert(&timer);
+    bool wasEmpty = (m_nbPending == 0);
+    m_nbPending ++;
+    TimerId id = (static_cast<uint64_t>(timer.generation) << 32) | (index + 1);
+    lock.unlock();
+
+    // The service thread does not tick while the wheel is empty
+    if (wasEmpty) {
+        m_wakeUp.notify_one();
+    }
+    return id;
+}
+
+void PcoTimerService::insert(Timer *timer)
+{
+    // Timers beyond the range of the wheel go to the last level, and are
+    // cascaded again until they come within range
+    uint64_t maxDelta = (uint64_t{1} << (SLOT_BITS * NB_LEVELS)) - 1;
+    uint64_t delta = std::min(timer->expiry - m_currentTick, maxDelta);
+    uint64_t slotTick = m_currentTick + delta;
+    unsigned int level = 0;
+    while (level < NB_LEVELS - 1 && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+        level ++;
+    }
+    timer->level = level;
+    timer->slot = static_cast<unsigned int>((slotTick >> (SLOT_BITS * level)) & (NB_SLOTS - 1));
+
+    timer->prev = nullptr;
+    timer->next = m_slots[level][timer->slot];
+    if (timer->next != nullptr) {
+        timer->next->prev = timer;
+    }
+    m_slots[level][timer->slot] = timer;
+    timer->linked = true;
+}
+
+void PcoTimerService::unlink(Timer *timer)
+{
+    if (timer->prev != nullptr) {
+        timer->prev->next = timer->next;
+    }
+    else {
+        m_slots[timer->level][timer->slot] = timer->next;
+    }
+    if (timer->next != nullptr) {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = nullptr;
+    timer->next = nullptr;
+    timer->linked = false;
+}
+
+void PcoTimerService::release(uint32_t index)
+{
+    Timer &timer = m_pool[index];
+    timer.callback = nullptr;
+    timer.generation ++;
+    if (timer.generation == 0) {
+        timer.generation = 1;
+    }
+    m_freeNodes.push_back(index);
+    m_nbPending --;
+}
+
+void PcoTimerService::cascade(unsigned int level)
+{
+    unsigned int slot = static_cast<unsigned int>((m_currentTick >> (SLOT_BITS * level)) & (NB_SLOTS - 1));
+    Timer *timer = m_slots[level][slot];
+    m_slots[level][slot] = nullptr;
+    while (timer != nullptr) {
+        Timer *next = timer->next;
+        insert(timer);
+        timer = next;
+    }
+}
+
+void PcoTimerService::advance(uint64_t tick, std::vector<std::function<void()>> &expired)
+{
+    while (m_currentTick < tick) {
+        if (m_nbPending == 0) {
+            m_currentTick = tick;
+            return;
+        }
+        m_currentTick ++;
+
+        // When a level wraps around, the next slot of the upper level is
+        // spread over the lower levels, before the current slot is run.
+        // Higher levels are cascaded first, as they feed the lower ones
+        for (unsigned int level = NB_LEVELS - 1; level >= 1; level --) {
+            if ((m_currentTick & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) == 0) {
+                cascade(level);
+            }
+        }
+
+        unsigned int slot = static_cast<unsigned int>(m_currentTick & (NB_SLOTS - 1));
+        Timer *timer = m_slots[0][slot];
+        m_slots[0][slot] = nullptr;
+        while (timer != nullptr) {
+            Timer *next = timer->next;
+            timer->linked = false;
+            timer->prev = nullptr;
+            timer->next = nullptr;
+            if (timer->period > 0) {
+                expired.push_back(timer->callback);
+                timer->expiry += timer->period;
+                insert(timer);
+            }
+            else {
+                expired.push_back(std::move(timer->callback));
+                release(timer->index);
+            }
+            timer = next;
+        }
+    }
+}
+
+void PcoTimerService::run()
+{
+    std::vector<std::function<void()>> expired;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        advance(nowTick(), expired);
+        if (!expired.empty()) {
+            lock.unlock();
+            for (auto &callback : expired) {
+                callback();
+            }
+            expired.clear();
+            lock.lock();
+            continue;
+        }
+        if (m_nbPending == 0) {
+            m_wakeUp.wait(lock);
+        }
+        else {
+            m_wakeUp.wait_until(lock, m_start + m_tick * (m_currentTick + 1));
+        }
+    }
+}
+
+uint64_t PcoTimerService::toTicks(uint64_t useconds) const
+{
+    uint64_t tick = static_cast<uint64_t>(m_tick.count());
+    return (useconds + tick - 1) / tick;
+}
+
+uint64_t PcoTimerService::nowTick() const
+{
+    return static_cast<uint64_t>((std::chrono::steady_clock::now() - m_start) / m_tick);
+}
@@ -0,0 +1,245 @@
+/*****************************************************************************
+ * Copyright (C) 2020 HEIG-VD                                                *
+ *                                                                           *
+ * This file is part of PcoSynchro.                                          *
+ *                                                                           *
+ * PcoSynchro is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as published  *
+ * by the Free Software Foundation, either version 3 of the License, or      *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * PcoSynchro is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU Lesser General Public License for more details.                       *
+ *                                                                           *
+ * You should have received a copy of the GNU Lesser General Public License  *
+ * along with PcoSynchro.  If not, see <https://www.gnu.org/licenses/>.      *
+ *****************************************************************************/
+
+#ifndef PCOTIMERSERVICE_H
+#define PCOTIMERSERVICE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PcoSemaphore;
+
+///
+/// \brief The PcoTimerService class
+///
+/// This class manages a large number of timers with a single thread.
+/// Instead of letting each thread sleep on its own kernel timer, a thread can
+/// ask the service to run a callback, or to release a semaphore, once a
+/// certain delay has elapsed.
+///
+/// The timers are stored in a hierarchical timer wheel of 4 levels of 256
+/// slots. Scheduling and cancelling a timer are O(1) operations, whatever
+/// the number of pending timers. The precision of the timers is one tick,
+/// 1 millisecond by default.
+///
+/// The callbacks are executed by the service thread, so they should be
+/// short and must not block. They can schedule or cancel other timers.
+///
+class PcoTimerService
+{
+public:
+
+    /// The identifier of a timer, used to cancel it
+    using TimerId = uint64_t;
+
+    /// A value that never identifies a timer
+    static constexpr TimerId InvalidTimer = 0;
+
+    ///
+    /// \brief gets the default PcoTimerService instance
+    /// \return A pointer to the shared instance, with a tick of 1 millisecond
+    ///
+    /// The object is created the first time this method is called.
+    ///
+    static PcoTimerService *getInstance();
+
+    ///
+    /// \brief PcoTimerService constructor
+    /// \param tickUseconds The duration of a tick, in microseconds
+    ///
+    /// The constructor starts the service thread.
+    ///
+    explicit PcoTimerService(uint64_t tickUseconds = 1000);
+
+    /// No copy
+    PcoTimerService (const PcoTimerService&) = delete;
+
+    /// No copy
+    PcoTimerService (const PcoTimerService&&) = delete;
+
+    /// No copy
+    PcoTimerService& operator= ( const PcoTimerService & ) = delete;
+
+    ///
+    /// \brief Destructor
+    ///
+    /// Stops the service thread. The pending timers are discarded without
+    /// being executed.
+    ///
+    ~PcoTimerService();
+
+    ///
+    /// \brief schedules a callback
+    /// \param useconds The delay, in microseconds, before running the callback
+    /// \param callback The function to run
+    /// \return The identifier of the timer
+    ///
+    /// The delay is rounded up to the next tick, so the callback never runs
+    /// before the delay has elapsed.
+    ///
+    TimerId schedule(uint64_t useconds, std::function<void()> callback);
+
+    ///
+    /// \brief schedules a periodic callback
+    /// \param useconds The period, in microseconds
+    /// \param callback The function to run at each period
+    /// \return The identifier of the timer
+    ///
+    /// The callback is run every period until the timer is cancelled.
+    ///
+    TimerId schedulePeriodic(uint64_t useconds, std::function<void()> callback);
+
+    ///
+    /// \brief releases a semaphore after a delay
+    /// \param useconds The delay, in microseconds, before releasing the semaphore
+    /// \param semaphore The semaphore to release. It has to outlive the timer
+    /// \return The identifier of the timer
+    ///
+    TimerId releaseAfter(uint64_t useconds, PcoSemaphore *semaphore);
+
+    ///
+    /// \brief cancels a timer
+    /// \param id The identifier of the timer
+    /// \return true if the timer has been cancelled, false if it was unknown
+    ///         or already executed
+    ///
+    bool cancel(TimerId id);
+
+    ///
+    /// \brief puts the calling thread asleep
+    /// \param useconds The number of microseconds to sleep
+    ///
+    /// The calling thread blocks on a semaphore released by the service,
+    /// so that no kernel timer is needed per sleeping thread.
+    ///
+    void sleep(uint64_t useconds);
+
+    ///
+    /// \brief gets the number of pending timers
+    /// \return The number of timers that are scheduled and not yet executed
+    ///
+    size_t nbPendingTimers();
+
+protected:
+
+    /// Number of bits used to index the slots of a level
+    static constexpr unsigned int SLOT_BITS = 8;
+
+    /// Number of slots per level
+    static constexpr unsigned int NB_SLOTS = 1u << SLOT_BITS;
+
+    /// Number of levels of the wheel
+    static constexpr unsigned int NB_LEVELS = 4;
+
+    ///
+    /// \brief The Timer struct
+    ///
+    /// A node of the intrusive lists stored in the slots of the wheel.
+    ///
+    struct Timer {
+        /// The tick at which the timer expires
+        uint64_t expiry{0};
+        /// The period in ticks, 0 for a one-shot timer
+        uint64_t period{0};
+        /// The function to run
+        std::function<void()> callback;
+        /// The index of the node in the pool
+        uint32_t index{0};
+        /// Incremented each time the node is reused, to detect stale ids
+        uint32_t generation{1};
+        /// The level of the slot holding the timer
+        unsigned int level{0};
+        /// The slot holding the timer within its level
+        unsigned int slot{0};
+        /// Indicates if the node currently belongs to a slot
+        bool linked{false};
+        /// Previous node of the slot
+        Timer *prev{nullptr};
+        /// Next node of the slot
+        Timer *next{nullptr};
+    };
+
+    /// Creates a new timer and puts it in the wheel
+    TimerId addTimer(uint64_t useconds, uint64_t periodUseconds, std::function<void()> callback);
+
+    /// Puts a timer in the slot corresponding to its expiry
+    void insert(Timer *timer);
+
+    /// Removes a timer from its slot
+    void unlink(Timer *timer);
+
+    /// Gives a timer node back to the pool and invalidates its id
+    void release(uint32_t index);
+
+    /// Moves the timers of a higher level slot to the lower levels
+    void cascade(unsigned int level);
+
+    /// Advances the wheel up to a tick, collecting the callbacks to run
+    void advance(uint64_t tick, std::vector<std::function<void()>> &expired);
+
+    /// The function executed by the service thread
+    void run();
+
+    /// Converts a number of microseconds to a number of ticks, rounded up
+    uint64_t toTicks(uint64_t useconds) const;
+
+    /// Gets the index of the current tick
+    uint64_t nowTick() const;
+
+    /// The duration of a tick
+    const std::chrono::microseconds m_tick;
+
+    /// The time corresponding to tick 0
+    const std::chrono::steady_clock::time_point m_start;
+
+    /// The last tick processed by the service thread
+    uint64_t m_currentTick{0};
+
+    /// The slots of the wheel, each one being a list of timers
+    Timer *m_slots[NB_LEVELS][NB_SLOTS] = {};
+
+    /// The timer nodes. A deque keeps the nodes at a stable address
+    std::deque<Timer> m_pool;
+
+    /// The indices of the free nodes of m_pool
+    std::vector<uint32_t> m_freeNodes;
+
+    /// The number of pending timers
+    size_t m_nbPending{0};
+
+    /// Indicates the service thread has to stop
+    bool m_stop{false};
+
+    /// Mutex protecting the wheel
+    std::mutex m_mutex;
+
+    /// Condition used to wake up the service thread
+    std::condition_variable m_wakeUp;
+
+    /// The service thread
+    std::thread m_thread;
+};
+
+#endif // PCOTIMERSERVICE_H
@@ -18,12 +18,23 @@ SOURCES += \
         ../src/pcomutex.cpp \
         ../src/pcosemaphore.cpp \
         ../src/pcoconditionvariable.cpp \
+        ../src/pcotimerservice.cpp \
+        ../src/pcohazardpointer.cpp \
+        ../src/pcoepochreclaimer.cpp \
         main.cpp
 
 HEADERS += \
+    ../src/pcoinline.h \
     ../src/pcomanager.h \
+    ../src/pcomanager_inline.h \
     ../src/pcothread.h \
+    ../src/pcothread_inline.h \
     ../src/pcomutex.h \
+    ../src/pcomutex_inline.h \
     ../src/pcosemaphore.h \
     ../src/pcoconditionvariable.h \
+    ../src/pcotimerservice.h \
+    ../src/pcohazardpointer.h \
+    ../src/pcoepochreclaimer.h \
+    ../src/pcofuture.h \
     ../src/pcotest.h
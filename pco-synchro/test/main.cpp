@@ -21,12 +21,18 @@
 
 #include <gtest/gtest.h>
 #include <numeric>
+#include <pthread.h>
+#include <sched.h>
 
 #include "../src/pcomutex.h"
 #include "../src/pcosemaphore.h"
 #include "../src/pcoconditionvariable.h"
 #include "../src/pcothread.h"
 #include "../src/pcomanager.h"
+#include "../src/pcotimerservice.h"
+#include "../src/pcohazardpointer.h"
+#include "../src/pcoepochreclaimer.h"
+#include "../src/pcofuture.h"
 #include "../src/pcotest.h"
 
 
@@ -106,6 +112,146 @@ TEST(PcoMutex, CriticalSection) {
     t2.join();
 }
 
+TEST(PcoMutex, PriorityInheritanceCriticalSection) {
+    // Req: A mutex using priority inheritance still protects a critical
+    //      section, and a recursive one does not block its owner
+
+    PcoMutex recursive(PcoMutex::Recursive, PcoMutex::PriorityInheritance);
+    ASSERT_DURATION_LE(1, {
+                           recursive.lock();
+                           recursive.lock();
+                           recursive.unlock();
+                           recursive.unlock();
+                       })
+
+    PcoMutex mutex(PcoMutex::NonRecursive, PcoMutex::PriorityInheritance);
+    int counter = 0;
+    std::vector<std::unique_ptr<PcoThread>> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back(std::make_unique<PcoThread>([&mutex, &counter](){
+            for (int i = 0; i < 10000; i++) {
+                mutex.lock();
+                counter ++;
+                mutex.unlock();
+            }
+        }));
+    }
+    for (auto &thread : threads) {
+        thread->join();
+    }
+    ASSERT_EQ(counter, 40000);
+}
+
+///
+/// Gives the calling thread a SCHED_FIFO priority. Returns false if the
+/// system refuses it, typically without the rights for real-time scheduling.
+///
+bool setRealTimePriority(int priority)
+{
+    sched_param param{};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+///
+/// Runs the calling thread as a real-time thread on a single CPU, as do the
+/// threads it creates, and restores its scheduling when destroyed.
+///
+class RealTimeScope
+{
+public:
+    explicit RealTimeScope(int priority)
+    {
+        pthread_getschedparam(pthread_self(), &m_policy, &m_param);
+        sched_getaffinity(0, sizeof(m_cpus), &m_cpus);
+        m_granted = setRealTimePriority(priority);
+        if (m_granted) {
+            // Priorities only order the threads that compete for one CPU
+            int cpu = 0;
+            while (!CPU_ISSET(cpu, &m_cpus)) {
+                cpu ++;
+            }
+            cpu_set_t single;
+            CPU_ZERO(&single);
+            CPU_SET(cpu, &single);
+            sched_setaffinity(0, sizeof(single), &single);
+        }
+    }
+
+    ~RealTimeScope()
+    {
+        sched_setaffinity(0, sizeof(m_cpus), &m_cpus);
+        pthread_setschedparam(pthread_self(), m_policy, &m_param);
+    }
+
+    bool granted() const { return m_granted; }
+
+private:
+    int m_policy;
+    sched_param m_param;
+    cpu_set_t m_cpus;
+    bool m_granted;
+};
+
+///
+/// Keeps the calling thread busy, without blocking, for a duration
+///
+void spin(std::chrono::milliseconds duration)
+{
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+TEST(PcoMutex, PriorityInheritanceOrder) {
+    // Req: The owner of a priority inheritance mutex runs with the priority
+    //      of the threads it blocks, so that a thread of intermediate
+    //      priority cannot delay them
+
+    // Above the priorities of the other threads, to start them in order
+    RealTimeScope scope(40);
+    if (!scope.granted()) {
+        GTEST_SKIP() << "Real-time scheduling is not allowed";
+    }
+    PcoMutex mutex(PcoMutex::NonRecursive, PcoMutex::PriorityInheritance);
+    if (mutex.priorityProtocol() != PcoMutex::PriorityInheritance) {
+        GTEST_SKIP() << "Priority inheritance is not supported";
+    }
+
+    std::vector<char> order;
+    std::mutex orderMutex;
+
+    std::thread low([&](){
+        ASSERT_TRUE(setRealTimePriority(10));
+        mutex.lock();
+        spin(std::chrono::milliseconds(50));
+        mutex.unlock();
+    });
+    std::this_thread::sleep_for(std::chrono::microseconds(5000));
+
+    std::thread high([&](){
+        ASSERT_TRUE(setRealTimePriority(30));
+        mutex.lock();
+        std::unique_lock<std::mutex> lock(orderMutex);
+        order.push_back('H');
+        mutex.unlock();
+    });
+    std::this_thread::sleep_for(std::chrono::microseconds(5000));
+
+    // Without inheritance, this thread would preempt the owner until done
+    std::thread medium([&](){
+        ASSERT_TRUE(setRealTimePriority(20));
+        spin(std::chrono::milliseconds(200));
+        std::unique_lock<std::mutex> lock(orderMutex);
+        order.push_back('M');
+    });
+
+    low.join();
+    high.join();
+    medium.join();
+    ASSERT_EQ(order, (std::vector<char>{'H', 'M'}));
+}
+
 #ifdef ALLOW_HELGRIND_ERRORS
 TEST(PcoSemaphore, Blocked) {
     // Req: A semaphore that reaches a negative value blocks the caller
@@ -170,6 +316,75 @@ TEST(PcoSemaphore, Order) {
     t3.join();
 }
 
+TEST(PcoSemaphore, PriorityOrderSamePriority) {
+    // Req: A priority ordered semaphore releases threads of the same
+    //      priority in FIFO order
+
+    PcoSemaphore sem(0, true, PcoSemaphore::QueueOrder::Priority);
+    int numOut = 0;
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < 3; t++) {
+        threads.emplace_back([&, t](){
+            std::this_thread::sleep_for(std::chrono::microseconds(2000 * (t + 1)));
+            sem.acquire();
+            std::unique_lock<std::mutex> lock(mutex);
+            ASSERT_EQ(numOut, t);
+            numOut ++;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(10000));
+    for (int t = 0; t < 3; t++) {
+        sem.release();
+        std::this_thread::sleep_for(std::chrono::microseconds(2000));
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(numOut, 3);
+}
+
+TEST(PcoSemaphore, PriorityOrderHigherFirst) {
+    // Req: A priority ordered semaphore releases the blocked thread with the
+    //      highest priority first, whatever their order of arrival
+
+    RealTimeScope scope(40);
+    if (!scope.granted()) {
+        GTEST_SKIP() << "Real-time scheduling is not allowed";
+    }
+
+    PcoSemaphore sem(0, true, PcoSemaphore::QueueOrder::Priority);
+    std::vector<int> order;
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+
+    // The lowest priority arrives first
+    const int priorities[] = {10, 20, 30};
+    for (int t = 0; t < 3; t++) {
+        threads.emplace_back([&, t](){
+            ASSERT_TRUE(setRealTimePriority(priorities[t]));
+            std::this_thread::sleep_for(std::chrono::microseconds(2000 * (t + 1)));
+            sem.acquire();
+            std::unique_lock<std::mutex> lock(mutex);
+            order.push_back(priorities[t]);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::microseconds(10000));
+    for (int t = 0; t < 3; t++) {
+        sem.release();
+        std::this_thread::sleep_for(std::chrono::microseconds(2000));
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(order, (std::vector<int>{30, 20, 10}));
+}
+
 #ifdef ALLOW_HELGRIND_ERRORS
 TEST(PcoConditionVariable, Blocked) {
     // Req: Waiting on a condition is blocking
@@ -386,6 +601,323 @@ TEST(PcoConditionVariable, WaitFor2) {
 }
 
 
+TEST(PcoTimerService, Callback) {
+    // Req: A scheduled callback is run once, not before its delay
+
+    PcoTimerService service;
+    std::promise<std::chrono::steady_clock::time_point> fired;
+    auto firedFuture = fired.get_future();
+    auto start = std::chrono::steady_clock::now();
+    service.schedule(20000, [&fired](){ fired.set_value(std::chrono::steady_clock::now()); });
+    ASSERT_EQ(firedFuture.wait_for(std::chrono::seconds(1)), std::future_status::ready);
+    ASSERT_GE(firedFuture.get() - start, std::chrono::microseconds(20000));
+    ASSERT_EQ(service.nbPendingTimers(), 0);
+}
+
+TEST(PcoTimerService, Cancel) {
+    // Req: A cancelled timer is never run, and cannot be cancelled twice
+
+    PcoTimerService service;
+    std::atomic<int> nbRuns{0};
+    auto id = service.schedule(20000, [&nbRuns](){ nbRuns ++; });
+    ASSERT_TRUE(service.cancel(id));
+    ASSERT_FALSE(service.cancel(id));
+    ASSERT_FALSE(service.cancel(PcoTimerService::InvalidTimer));
+    std::this_thread::sleep_for(std::chrono::microseconds(50000));
+    ASSERT_EQ(nbRuns, 0);
+}
+
+TEST(PcoTimerService, ManyTimers) {
+    // Req: Timers spread over several levels of the wheel all expire in order
+
+    PcoTimerService service(100);
+    std::mutex mutex;
+    std::vector<int> order;
+    for (int i = 10; i >= 0; i--) {
+        service.schedule(static_cast<uint64_t>(i) * 3000, [&mutex, &order, i](){
+            std::lock_guard<std::mutex> guard(mutex);
+            order.push_back(i);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(100000));
+    std::lock_guard<std::mutex> guard(mutex);
+    ASSERT_EQ(order.size(), 11);
+    ASSERT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST(PcoTimerService, PeriodicAndSemaphore) {
+    // Req: A periodic timer runs until cancelled, and a semaphore can be
+    //      released by the service
+
+    PcoTimerService service;
+    PcoSemaphore sem(0);
+    std::atomic<int> nbRuns{0};
+    auto id = service.schedulePeriodic(5000, [&nbRuns](){ nbRuns ++; });
+    service.releaseAfter(30000, &sem);
+    ASSERT_DURATION_LE(1, sem.acquire())
+    ASSERT_TRUE(service.cancel(id));
+    ASSERT_GE(nbRuns, 2);
+    int runs = nbRuns;
+    std::this_thread::sleep_for(std::chrono::microseconds(20000));
+    ASSERT_EQ(nbRuns, runs);
+
+    auto start = std::chrono::steady_clock::now();
+    service.sleep(10000);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::microseconds(10000));
+}
+
+///
+/// A node of the lock-free stacks used to test the memory reclamation.
+/// It counts the living nodes and detects the accesses to deleted nodes.
+///
+struct ReclaimedNode
+{
+    static std::atomic<int> nbAlive;
+    static const int magicValue = 0x5C0FFEE;
+
+    explicit ReclaimedNode(int value) : value(value) { nbAlive ++; }
+    ~ReclaimedNode() { magic = 0; nbAlive --; }
+
+    int magic{magicValue};
+    int value;
+    ReclaimedNode *next{nullptr};
+};
+
+std::atomic<int> ReclaimedNode::nbAlive{0};
+
+///
+/// Pushes and pops nodes on a Treiber stack from several PcoThreads, with
+/// random sleeps between the operations. The protect function is called
+/// before a thread dereferences the top of the stack.
+///
+template<typename Reclaimer, typename Pop>
+void stressLockFreeStack(Reclaimer &reclaimer, Pop pop)
+{
+    std::atomic<ReclaimedNode *> top{nullptr};
+    std::atomic<bool> corrupted{false};
+    std::atomic<int> nbPopped{0};
+    const int nbThreads = 4;
+    const int nbOperations = 2000;
+
+    PcoManager::getInstance()->setMaxSleepDuration(20);
+    std::vector<std::unique_ptr<PcoThread>> threads;
+    for (int t = 0; t < nbThreads; t++) {
+        threads.emplace_back(std::make_unique<PcoThread>([&, t](){
+            for (int i = 0; i < nbOperations; i++) {
+                auto node = new ReclaimedNode(t * nbOperations + i);
+                node->next = top.load();
+                while (!top.compare_exchange_weak(node->next, node)) {}
+                PcoManager::getInstance()->randomSleep();
+
+                ReclaimedNode *popped = pop(reclaimer, top, corrupted);
+                if (popped != nullptr) {
+                    nbPopped ++;
+                    reclaimer.retire(popped);
+                }
+                PcoManager::getInstance()->randomSleep();
+            }
+        }));
+    }
+    for (auto &thread : threads) {
+        thread->join();
+    }
+    PcoManager::getInstance()->setMaxSleepDuration(0);
+
+    ASSERT_FALSE(corrupted);
+    ASSERT_EQ(nbPopped, nbThreads * nbOperations);
+    ASSERT_EQ(top.load(), nullptr);
+}
+
+TEST(PcoHazardPointer, StressStack) {
+    // Req: A node protected by a hazard pointer is never deleted, and all the
+    //      retired nodes are deleted in the end
+
+    {
+        PcoHazardPointerDomain domain(16);
+        stressLockFreeStack(domain, [](PcoHazardPointerDomain &domain, std::atomic<ReclaimedNode *> &top,
+                                       std::atomic<bool> &corrupted) {
+            ReclaimedNode *node;
+            do {
+                node = domain.protect(top);
+                if (node == nullptr) {
+                    break;
+                }
+                if (node->magic != ReclaimedNode::magicValue) {
+                    corrupted = true;
+                }
+            } while (!top.compare_exchange_weak(node, node->next));
+            domain.clear();
+            return node;
+        });
+        // The records of the finished PcoThreads have been released
+        domain.scan();
+        ASSERT_EQ(domain.nbRetired(), 0);
+    }
+    ASSERT_EQ(ReclaimedNode::nbAlive, 0);
+}
+
+TEST(PcoEpochReclaimer, StressStack) {
+    // Req: A node retired while a thread is in a critical section is not
+    //      deleted before the thread leaves it, and all the retired nodes
+    //      are deleted in the end
+
+    {
+        PcoEpochReclaimer reclaimer(16);
+        stressLockFreeStack(reclaimer, [](PcoEpochReclaimer &reclaimer, std::atomic<ReclaimedNode *> &top,
+                                          std::atomic<bool> &corrupted) {
+            PcoEpochReclaimer::Guard guard(reclaimer);
+            ReclaimedNode *node = top.load();
+            while (node != nullptr) {
+                if (node->magic != ReclaimedNode::magicValue) {
+                    corrupted = true;
+                }
+                if (top.compare_exchange_weak(node, node->next)) {
+                    break;
+                }
+            }
+            return node;
+        });
+        ASSERT_GT(reclaimer.epoch(), 0);
+        reclaimer.tryAdvance();
+        reclaimer.tryAdvance();
+        ASSERT_EQ(reclaimer.nbRetired(), 0);
+    }
+    ASSERT_EQ(ReclaimedNode::nbAlive, 0);
+}
+
+TEST(PcoEpochReclaimer, CriticalSectionBlocksReclamation) {
+    // Req: A thread in a critical section prevents the deletion of the nodes
+    //      retired meanwhile
+
+    PcoEpochReclaimer reclaimer;
+    PcoSemaphore entered(0);
+    PcoSemaphore retired(0);
+    PcoThread reader([&](){
+        PcoEpochReclaimer::Guard guard(reclaimer);
+        entered.release();
+        retired.acquire();
+    });
+    entered.acquire();
+    reclaimer.retire(new ReclaimedNode(0));
+    for (int i = 0; i < 4; i++) {
+        reclaimer.tryAdvance();
+    }
+    ASSERT_EQ(ReclaimedNode::nbAlive, 1);
+    retired.release();
+    reader.join();
+    for (int i = 0; i < 4; i++) {
+        reclaimer.tryAdvance();
+    }
+    ASSERT_EQ(ReclaimedNode::nbAlive, 0);
+}
+
+TEST(PcoFuture, ThenChain) {
+    // Req: A value set by a PcoThread is received by the future and goes
+    //      through the chained continuations
+
+    PcoPromise<int> promise;
+    auto result = promise.getFuture()
+            .then([](int value){ return value * 2; })
+            .then([](int value){ return std::to_string(value); });
+    PcoThread producer([](PcoPromise<int> promise){ promise.setValue(21); }, promise);
+    ASSERT_EQ(result.get(), "42");
+    producer.join();
+
+    PcoPromise<void> voidPromise;
+    auto voidResult = voidPromise.getFuture().then([](){ return 1; });
+    voidPromise.setValue();
+    ASSERT_EQ(voidResult.get(), 1);
+}
+
+TEST(PcoFuture, Exceptions) {
+    // Req: An exception set by the promise, or thrown by a continuation, is
+    //      rethrown by get(), and a destroyed promise breaks its future
+
+    PcoPromise<int> promise;
+    auto future = promise.getFuture().then([](int) -> int { throw std::logic_error("continuation"); });
+    promise.setValue(1);
+    ASSERT_THROW(future.get(), std::logic_error);
+
+    PcoFuture<int> broken;
+    {
+        PcoPromise<int> lost;
+        broken = lost.getFuture();
+    }
+    ASSERT_THROW(broken.get(), std::future_error);
+}
+
+TEST(PcoFuture, BlockedThreadAccounting) {
+    // Req: A thread waiting for a future is counted as blocked by the PcoManager
+
+    PcoPromise<int> promise;
+    auto future = promise.getFuture();
+    int nbBlocked = PcoManager::getInstance()->nbBlockedThreads();
+    PcoThread consumer([future](){ future.get(); });
+    while (PcoManager::getInstance()->nbBlockedThreads() == nbBlocked) {
+        PcoThread::usleep(100);
+    }
+    promise.setValue(0);
+    consumer.join();
+    ASSERT_EQ(PcoManager::getInstance()->nbBlockedThreads(), nbBlocked);
+}
+
+TEST(PcoFuture, WhenAllWhenAny) {
+    // Req: whenAll() is ready once all futures are, and whenAny() as soon as
+    //      one of them is
+
+    std::vector<PcoPromise<int>> promises(3);
+    std::vector<PcoFuture<int>> futures;
+    for (auto &promise : promises) {
+        futures.push_back(promise.getFuture());
+    }
+    auto all = whenAll(futures);
+    auto any = whenAny(futures);
+    ASSERT_FALSE(any.isReady());
+    promises[1].setValue(1);
+    ASSERT_EQ(any.get().index, 1);
+    ASSERT_FALSE(all.isReady());
+    promises[0].setValue(0);
+    promises[2].setValue(2);
+    int sum = 0;
+    for (auto &future : all.get()) {
+        sum += future.get();
+    }
+    ASSERT_EQ(sum, 3);
+}
+
+TEST(PcoFuture, EarlyExitSearch) {
+    // Req: The first worker to find a result wins, and the others notice the
+    //      cancellation of their future and stop early
+
+    const int nbWorkers = 4;
+    std::vector<PcoPromise<int>> promises(nbWorkers);
+    std::vector<PcoFuture<int>> futures;
+    std::vector<std::unique_ptr<PcoThread>> workers;
+    for (int i = 0; i < nbWorkers; i++) {
+        futures.push_back(promises[i].getFuture());
+        workers.emplace_back(std::make_unique<PcoThread>([i](PcoPromise<int> promise){
+            if (i == 2) {
+                promise.setValue(i);
+                return;
+            }
+            while (!promise.isCancelled()) {
+                PcoThread::usleep(100);
+            }
+        }, promises[i]));
+    }
+    auto first = whenAny(futures).get();
+    for (auto &future : first.futures) {
+        future.cancel();
+    }
+    ASSERT_DURATION_LE(1, {
+                           for (auto &worker : workers) {
+                               worker->join();
+                           }
+                       })
+    ASSERT_EQ(first.futures[first.index].get(), 2);
+    ASSERT_THROW(futures[0].get(), PcoFutureCancelled);
+}
+
 TEST(PcoThread, LambdaRef) {
     // Req: A thread should execute and finish, letting another one do the join
 
@@ -0,0 +1,197 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "factorizer.h"
+#include "smallprimes.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+
+/**
+ * @brief Arithmetic modulo an odd number in Montgomery form
+ *
+ * A value a is represented by a * 2^64 mod n, so that a product only needs
+ * multiplications and no 128-bit division.
+ */
+class Montgomery
+{
+public:
+    explicit Montgomery(uint64_t modulus)
+        : modulus(modulus), inverse(inverse64(modulus))
+    {
+        const uint64_t r = static_cast<uint64_t>((static_cast<unsigned __int128>(1) << 64) % modulus);
+        rSquared = static_cast<uint64_t>(static_cast<unsigned __int128>(r) * r % modulus);
+    }
+
+    uint64_t toMontgomery(uint64_t value) const
+    {
+        return multiply(value % modulus, rSquared);
+    }
+
+    // Product of two values in Montgomery form, in Montgomery form
+    uint64_t multiply(uint64_t a, uint64_t b) const
+    {
+        const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        const uint64_t m = static_cast<uint64_t>(product) * inverse;
+        const uint64_t mnHigh = static_cast<uint64_t>((static_cast<unsigned __int128>(m) * modulus) >> 64);
+        const uint64_t high = static_cast<uint64_t>(product >> 64);
+        // The low halves of product and m * n are equal
+        return high >= mnHigh ? high - mnHigh : high - mnHigh + modulus;
+    }
+
+    uint64_t add(uint64_t a, uint64_t b) const
+    {
+        return a >= modulus - b ? a - (modulus - b) : a + b;
+    }
+
+private:
+    uint64_t modulus;
+    uint64_t inverse;
+    uint64_t rSquared;
+};
+
+} // namespace
+
+Factorizer::Factorizer(size_t nbThreads)
+    : nbThreads(nbThreads == 0 ? 1 : nbThreads), pool(nbThreads)
+{
+}
+
+std::vector<uint64_t> Factorizer::factorize(uint64_t number)
+{
+    std::vector<uint64_t> factors;
+    if (number < 2)
+    {
+        return factors;
+    }
+
+    while (number % 2 == 0)
+    {
+        factors.push_back(2);
+        number /= 2;
+    }
+    // smallPrimes[0] is 2
+    for (size_t k = 1; k < nbSmallPrimes && smallPrimes[k] < trialDivisionLimit; ++k)
+    {
+        const uint64_t p = smallPrimes[k];
+        if (p * p > number)
+        {
+            break;
+        }
+        while (number * smallPrimeInverses[k] <= smallPrimeLimits[k])
+        {
+            factors.push_back(p);
+            number /= p;
+        }
+    }
+
+    if (number > 1)
+    {
+        split(number, factors);
+    }
+    std::sort(factors.begin(), factors.end());
+    return factors;
+}
+
+void Factorizer::split(uint64_t number, std::vector<uint64_t> &factors)
+{
+    // Without factor below trialDivisionLimit, a number below its square
+    // is prime
+    if (number < trialDivisionLimit * trialDivisionLimit || millerRabin.isPrime(number))
+    {
+        factors.push_back(number);
+        return;
+    }
+    const uint64_t factor = findFactor(number);
+    split(factor, factors);
+    split(number / factor, factors);
+}
+
+uint64_t Factorizer::findFactor(uint64_t number)
+{
+    std::atomic<uint64_t> found{0};
+
+    if (nbThreads == 1)
+    {
+        for (uint64_t increment = 1; found == 0; ++increment)
+        {
+            const uint64_t factor = rho(number, 2, increment, found);
+            if (factor != 0)
+            {
+                return factor;
+            }
+        }
+    }
+
+    // Each thread tries its own sequence of increments, so that no two
+    // threads run the same search
+    pool.run(nbThreads, [&](size_t i)
+    {
+        for (uint64_t increment = i + 1; found.load(std::memory_order_relaxed) == 0; increment += nbThreads)
+        {
+            const uint64_t factor = rho(number, 2 + i, increment, found);
+            if (factor != 0)
+            {
+                uint64_t expected = 0;
+                found.compare_exchange_strong(expected, factor);
+                return;
+            }
+        }
+    });
+    return found;
+}
+
+uint64_t Factorizer::rho(uint64_t number, uint64_t start, uint64_t increment, const std::atomic<uint64_t> &found)
+{
+    // Brent's cycle detection on x -> x^2 + increment. The differences are
+    // multiplied together, so that a gcd is only computed every gcdBatch
+    // steps. Multiplying by 2^64 does not change a gcd with an odd number,
+    // so the values stay in Montgomery form
+    const Montgomery arithmetic(number);
+    const uint64_t c = arithmetic.toMontgomery(increment);
+    const auto f = [&](uint64_t x) { return arithmetic.add(arithmetic.multiply(x, x), c); };
+
+    uint64_t y = arithmetic.toMontgomery(start);
+    uint64_t x = y;
+    uint64_t ys = y;
+    uint64_t q = arithmetic.toMontgomery(1);
+    uint64_t g = 1;
+
+    for (uint64_t r = 1; g == 1; r *= 2)
+    {
+        if (found.load(std::memory_order_relaxed) != 0)
+        {
+            return 0;
+        }
+        x = y;
+        for (uint64_t i = 0; i < r; ++i)
+        {
+            y = f(y);
+        }
+        for (uint64_t k = 0; k < r && g == 1; k += gcdBatch)
+        {
+            ys = y;
+            const uint64_t steps = std::min(gcdBatch, r - k);
+            for (uint64_t i = 0; i < steps; ++i)
+            {
+                y = f(y);
+                q = arithmetic.multiply(q, x > y ? x - y : y - x);
+            }
+            g = std::gcd(q, number);
+        }
+    }
+
+    if (g == number)
+    {
+        // The batch went past the factor, so it is replayed one step at a time
+        do
+        {
+            ys = f(ys);
+            g = std::gcd(x > ys ? x - ys : ys - x, number);
+        } while (g == 1);
+    }
+    // g == number means this increment failed
+    return g == number ? 0 : g;
+}
@@ -0,0 +1,62 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef FACTORIZER_H
+#define FACTORIZER_H
+
+#include "primenumberdetector.h"
+#include "workerpool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Decomposition of 64-bit numbers into prime factors
+ *
+ * The small factors are removed by trial division. The remaining part is
+ * split by Pollard's rho algorithm, in Brent's variant, with Montgomery
+ * multiplications, until Miller-Rabin reports that every part is prime.
+ *
+ * With several threads, each thread runs rho with its own parameters, and
+ * the first one finding a factor cancels the others.
+ */
+class Factorizer
+{
+public:
+    /**
+     * @brief Construct a factorizer
+     * @param nbThreads Number of rho searches run in parallel
+     */
+    explicit Factorizer(size_t nbThreads = 1);
+
+    /**
+     * @brief Prime factors of a number
+     * @param number The number to factorize
+     * @return The prime factors in increasing order, repeated according to
+     *         their multiplicity. Empty for 0 and 1
+     */
+    std::vector<uint64_t> factorize(uint64_t number);
+
+    /**
+     * @brief A factor of an odd composite number without small factors
+     * @param number An odd composite number, greater than 1
+     * @return A divisor of number, strictly between 1 and number
+     */
+    uint64_t findFactor(uint64_t number);
+
+private:
+    // Primes below this bound are removed by trial division
+    static const uint64_t trialDivisionLimit = 1 << 12;
+    // Number of rho steps whose differences are multiplied before a gcd
+    static const uint64_t gcdBatch = 128;
+
+    static uint64_t rho(uint64_t number, uint64_t start, uint64_t increment, const std::atomic<uint64_t> &found);
+    void split(uint64_t number, std::vector<uint64_t> &factors);
+
+    size_t nbThreads;
+    WorkerPool pool;
+    PrimeNumberDetectorMillerRabin millerRabin;
+};
+
+#endif // FACTORIZER_H
@@ -1,8 +1,196 @@
 #include "logging.h"
 
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 void LogFunction(const std::string& str) {
     // write to socket, file, console, e.t.c
 #ifndef LOGGING_BE_SILENT
     std::cout << str; //  << std::endl;
 #endif
 }
+
+namespace {
+
+// Time the writer thread gathers lines once woken, and size of a buffer
+// that ends it earlier
+const std::chrono::milliseconds writePeriod(10);
+const size_t wakeUpBytes = 64 * 1024;
+
+// The lines logged by one thread and not written yet. The mutex is only
+// shared with the writer thread, for the time of a swap
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::string lines;
+    bool finished = false;
+};
+
+class Sink {
+public:
+    static Sink& instance() {
+        static Sink sink;
+        return sink;
+    }
+
+    ~Sink() {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_stopping = true;
+        }
+        m_wakeUp.notify_one();
+        m_writer.join();
+        writeAll();
+    }
+
+    std::shared_ptr<ThreadBuffer> registerThread() {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+        m_buffers.push_back(buffer);
+        return buffer;
+    }
+
+    // Called when a buffer gets its first line, or gets full
+    void wakeUp(bool full) {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_pending = true;
+            m_full = m_full || full;
+        }
+        m_wakeUp.notify_one();
+    }
+
+    // Writes the lines of all the buffers, in the order of the buffers
+    void writeAll() {
+        std::lock_guard<std::mutex> writeLock(m_writeMutex);
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(m_registryMutex);
+            buffers = m_buffers;
+        }
+
+        std::string text;
+        std::string lines;
+        bool hasFinished = false;
+        for (const auto& buffer : buffers) {
+            {
+                std::lock_guard<std::mutex> lock(buffer->mutex);
+                lines.swap(buffer->lines);
+                hasFinished = hasFinished || buffer->finished;
+            }
+            text += lines;
+            lines.clear();
+        }
+        if (!text.empty()) {
+            LogFunction(text);
+        }
+
+        if (hasFinished) {
+            // The buffers of the threads that exited are empty now, and
+            // cannot be filled again
+            std::lock_guard<std::mutex> lock(m_registryMutex);
+            for (size_t i = 0; i < m_buffers.size();) {
+                std::lock_guard<std::mutex> bufferLock(m_buffers[i]->mutex);
+                if (m_buffers[i]->finished && m_buffers[i]->lines.empty()) {
+                    m_buffers[i] = m_buffers.back();
+                    m_buffers.pop_back();
+                }
+                else {
+                    ++i;
+                }
+            }
+        }
+    }
+
+private:
+    Sink() : m_writer(&Sink::writerLoop, this) { }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        while (!m_stopping) {
+            m_wakeUp.wait(lock, [this] { return m_stopping || m_pending; });
+            m_wakeUp.wait_for(lock, writePeriod, [this] { return m_stopping || m_full; });
+            // Cleared before the buffers are emptied, so that a buffer
+            // filled again wakes the next iteration
+            m_pending = false;
+            m_full = false;
+            lock.unlock();
+            writeAll();
+            lock.lock();
+        }
+    }
+
+    std::mutex m_registryMutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> m_buffers;
+    std::mutex m_writeMutex;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopping = false;
+    // Some buffer has lines, or is full, since the last writeAll()
+    bool m_pending = false;
+    bool m_full = false;
+    // Started last, once everything it uses is constructed
+    std::thread m_writer;
+};
+
+struct ThreadState {
+    std::shared_ptr<ThreadBuffer> buffer = Sink::instance().registerThread();
+    std::ostringstream stream;
+    bool streamInUse = false;
+
+    ~ThreadState() {
+        // The sink may already be destroyed, only the buffer is used
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->finished = true;
+    }
+};
+
+ThreadState& threadState() {
+    thread_local ThreadState state;
+    return state;
+}
+
+} // namespace
+
+void Log::flush() {
+    Sink::instance().writeAll();
+}
+
+Log::Log(LogLevel) {
+    ThreadState& state = threadState();
+    if (state.streamInUse) {
+        m_ownStream = std::make_unique<std::ostringstream>();
+        m_stream = m_ownStream.get();
+        return;
+    }
+    // The stream is reset to its initial state, formatting flags included
+    static const std::ostringstream initial;
+    state.streamInUse = true;
+    state.stream.str(std::string());
+    state.stream.clear();
+    state.stream.copyfmt(initial);
+    m_stream = &state.stream;
+}
+
+Log::~Log() {
+    ThreadState& state = threadState();
+    const std::string line = m_stream->str();
+    if (!m_ownStream) {
+        state.streamInUse = false;
+    }
+
+    bool first;
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(state.buffer->mutex);
+        first = state.buffer->lines.empty();
+        state.buffer->lines += line;
+        full = state.buffer->lines.size() >= wakeUpBytes;
+    }
+    if (first || full) {
+        Sink::instance().wakeUp(full);
+    }
+}
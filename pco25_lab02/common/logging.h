@@ -3,38 +3,83 @@
 
 // Logging idea taken from:
 // https://stackoverflow.com/questions/511768/how-to-use-my-logging-class-like-a-std-c-stream
+//
+// Usage: Logging << "text" << value << std::endl;     (level Info)
+//        LOG(LogLevel::Debug) << "text" << std::endl;
+//
+// A statement whose level is disabled evaluates nothing, not even its
+// operands. The levels below LOGGING_MIN_LEVEL are removed at compile
+// time, the others can be disabled at runtime with Log::setLevel().
+// LOGGING_MIN_LEVEL is read where LOG() is used, so it can differ between
+// translation units.
+//
+// The lines are appended to a buffer of the logging thread, without any
+// shared lock, and a background thread writes the buffers with
+// LogFunction(). It sleeps while nothing is logged, and once woken gathers
+// the lines for a short period. The lines of one thread keep their order,
+// but the lines of different threads can be reordered. Log::flush() writes
+// everything logged so far.
 
+#include <atomic>
+#include <memory>
+#include <ostream>
 #include <sstream>
-#include <functional>
-#include <iostream>
-#include <mutex>
+#include <string>
+
+enum class LogLevel {
+    Debug = 0,
+    Info = 1,
+    Warning = 2,
+    Error = 3,
+    Off = 4
+};
+
+// Lowest level compiled in, as the integer value of a LogLevel
+#ifndef LOGGING_MIN_LEVEL
+#ifdef LOGGING_BE_SILENT
+#define LOGGING_MIN_LEVEL 4
+#else
+#define LOGGING_MIN_LEVEL 0
+#endif
+#endif
 
 void LogFunction(const std::string& str);
 
-#define LOG(loggingFuntion) \
-    Log(loggingFuntion).GetStream()
+// The first test is constant, so the whole statement is removed for the
+// levels below LOGGING_MIN_LEVEL
+#define LOG(level) \
+    if (static_cast<int>(level) < LOGGING_MIN_LEVEL || !Log::isEnabled(level)) {} else Log(level).GetStream()
 
-#define Logging LOG(LogFunction)
+#define Logging LOG(LogLevel::Info)
 
 class Log {
-    using LogFunctionType = std::function<void(const std::string&)>;
-
 public:
-    explicit Log(LogFunctionType logFunction) : m_logFunction(std::move(logFunction)) { }
-    std::ostringstream& GetStream() { return m_stringStream; }
-    ~Log() { getMutex().lock();m_logFunction(m_stringStream.str());getMutex().unlock(); }
-
-    std::mutex & getMutex() {
-        static std::mutex themutex;
-        return themutex;
+    // Runtime part of the test of LOG()
+    static bool isEnabled(LogLevel level) {
+        return level != LogLevel::Off && static_cast<int>(level) >= runtimeLevel.load(std::memory_order_relaxed);
     }
 
-private:
-    std::ostringstream m_stringStream;
-    LogFunctionType m_logFunction;
-};
+    // Lowest level written, Info by default
+    static void setLevel(LogLevel level) { runtimeLevel.store(static_cast<int>(level), std::memory_order_relaxed); }
+    static LogLevel level() { return static_cast<LogLevel>(runtimeLevel.load(std::memory_order_relaxed)); }
+
+    // Writes the lines of all the threads, and waits for LogFunction()
+    static void flush();
 
+    explicit Log(LogLevel level);
+    ~Log();
+    Log(const Log&) = delete;
+    Log& operator=(const Log&) = delete;
 
+    std::ostream& GetStream() { return *m_stream; }
 
+private:
+    static inline std::atomic<int> runtimeLevel{static_cast<int>(LogLevel::Info)};
+
+    // The stream of the thread, reused from one statement to the next, or
+    // m_ownStream when a statement is nested in another one
+    std::ostringstream* m_stream;
+    std::unique_ptr<std::ostringstream> m_ownStream;
+};
 
 #endif // LOGGING_H
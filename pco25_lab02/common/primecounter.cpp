@@ -0,0 +1,610 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "primecounter.h"
+
+#include "segmentedsieve.h"
+#include "uint128.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+// Below, the whole range is sieved
+const uint64_t sieveLimit = 1 << 20;
+
+// A segment holds 2^18 odd numbers, 32 KiB, and counts its bits by blocks
+// of 1024 odd numbers
+const size_t segmentWords = 4096;
+const size_t blockWords = 16;
+const uint64_t segmentSpan = 128 * segmentWords;
+
+// Consecutive segments processed by a task, with the same buffers
+const size_t segmentsPerTask = 16;
+
+// 2, 3, 5, 7, 11 and 13, whose multiples are crossed off from a pattern
+// that repeats every 3 * 5 * 7 * 11 * 13 odd numbers, that is every 15015
+// bytes, and whose leaves are computed by TinyPhi
+const size_t nbTinyPrimes = 6;
+const size_t patternBytes = 15015;
+
+// Above this prime, crossing off the multiples one by one and updating the
+// counts costs less than counting the whole segment again
+const uint64_t countedCrossOffPrime = 64;
+
+const std::vector<uint8_t> &presievePattern()
+{
+    static const std::vector<uint8_t> pattern = []
+    {
+        std::vector<uint8_t> bits(patternBytes, 0xFF);
+        for (uint64_t p : {3, 5, 7, 11, 13})
+        {
+            for (uint64_t i = p / 2; i < patternBytes * 8; i += p)
+            {
+                bits[i / 8] &= static_cast<uint8_t>(~(1u << (i % 8)));
+            }
+        }
+        return bits;
+    }();
+    return pattern;
+}
+
+/**
+ * @brief phi(u, b) for b below nbTinyPrimes, in constant time
+ *
+ * The numbers coprime to the first b primes repeat with their product q,
+ * so phi(u, b) = (u / q) * phi(q, b) + phi(u % q, b), the last term being
+ * read from a table of q entries.
+ */
+class TinyPhi
+{
+public:
+    static const TinyPhi &instance()
+    {
+        static const TinyPhi tinyPhi;
+        return tinyPhi;
+    }
+
+    uint64_t phi(uint64_t u, size_t b) const
+    {
+        const std::vector<uint32_t> &table = tables[b];
+        const uint64_t product = table.size() - 1;
+        return u / product * table[product] + table[u % product];
+    }
+
+private:
+    TinyPhi()
+    {
+        const uint64_t primes[] = {2, 3, 5, 7, 11};
+        uint64_t product = 1;
+        for (size_t b = 0; b < nbTinyPrimes; ++b)
+        {
+            // table[r] is phi(r, b) for r up to the product
+            std::vector<uint32_t> table(product + 1, 0);
+            for (uint64_t r = 1; r <= product; ++r)
+            {
+                bool coprime = true;
+                for (size_t i = 0; i < b && coprime; ++i)
+                {
+                    coprime = r % primes[i] != 0;
+                }
+                table[r] = table[r - 1] + coprime;
+            }
+            tables.push_back(std::move(table));
+            if (b + 1 < nbTinyPrimes)
+            {
+                product *= primes[b];
+            }
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> tables;
+};
+
+/**
+ * @brief The odd numbers of [low, low + segmentSpan), one bit each
+ *
+ * The number of bits set is kept for each block of blockWords words, so
+ * that the count of the bits below a position reads the blocks before it
+ * and the words of its block only. The small primes cross off most of the
+ * bits, so they leave the counts to be recomputed all at once when needed,
+ * while the larger ones update them bit by bit.
+ *
+ * The functions that count bits are always inlined, so that popcount is
+ * compiled to a single instruction in the callers that target popcnt.
+ */
+class OddSegment
+{
+public:
+    OddSegment() : words(segmentWords), blockCounts(segmentWords / blockWords) {}
+
+    // Starts from the odd numbers without any factor up to 13, 1 included.
+    // low must be a multiple of 16, so that the pattern is copied bytewise
+    void reset(uint64_t low)
+    {
+        this->low = low;
+        const std::vector<uint8_t> &pattern = presievePattern();
+        uint8_t *bytes = reinterpret_cast<uint8_t *>(words.data());
+        size_t offset = static_cast<size_t>(low / 16 % patternBytes);
+        for (size_t copied = 0; copied < 8 * segmentWords;)
+        {
+            const size_t length = std::min(8 * segmentWords - copied, patternBytes - offset);
+            std::memcpy(bytes + copied, pattern.data() + offset, length);
+            copied += length;
+            offset = 0;
+        }
+        countsValid = false;
+    }
+
+    // Clears the odd multiples of a prime above 13, the prime included. The
+    // smaller primes must be crossed off already, which clears the
+    // multiples below the square of the prime
+    inline __attribute__((always_inline)) void crossOff(uint64_t prime)
+    {
+        const bool inSegment = prime >= low && prime < low + segmentSpan;
+        if (prime > countedCrossOffPrime)
+        {
+            updateCounts();
+            if (inSegment)
+            {
+                clear<true>((prime - low) / 2);
+            }
+            clearMultiples<true>(prime);
+        }
+        else
+        {
+            if (inSegment)
+            {
+                clear<false>((prime - low) / 2);
+            }
+            clearMultiples<false>(prime);
+            countsValid = false;
+        }
+    }
+
+    // Clears the odd multiples of the primes of [first, last), given in
+    // increasing order, all above 13 and below low
+    template<typename Iterator>
+    void crossOffAll(Iterator first, Iterator last)
+    {
+        for (; first != last; ++first)
+        {
+            clearMultiples<false>(*first);
+        }
+        countsValid = false;
+    }
+
+    // Number of odd numbers of the segment that are not crossed off
+    inline __attribute__((always_inline)) uint64_t count()
+    {
+        updateCounts();
+        return total;
+    }
+
+    // Number of odd numbers of the segment up to n, which must not go
+    // beyond the segment, that are not crossed off
+    class Counter
+    {
+    public:
+        inline __attribute__((always_inline)) explicit Counter(OddSegment &segment) : segment(segment)
+        {
+            segment.updateCounts();
+        }
+
+        // The calls must be made with increasing values of n, and no prime
+        // crossed off in between
+        inline __attribute__((always_inline)) uint64_t countUpTo(uint64_t n)
+        {
+            const uint64_t nbBits = (n - segment.low + 1) / 2;
+            while ((block + 1) * 64 * blockWords <= nbBits)
+            {
+                countBefore += segment.blockCounts[block++];
+            }
+            uint64_t count = countBefore;
+            size_t word = block * blockWords;
+            for (; (word + 1) * 64 <= nbBits; ++word)
+            {
+                count += __builtin_popcountll(segment.words[word]);
+            }
+            if (nbBits % 64 != 0)
+            {
+                count += __builtin_popcountll(segment.words[word] & (~uint64_t{0} >> (64 - nbBits % 64)));
+            }
+            return count;
+        }
+
+    private:
+        const OddSegment &segment;
+        size_t block = 0;
+        uint64_t countBefore = 0;
+    };
+
+private:
+    template<bool counted>
+    void clear(uint64_t bit)
+    {
+        if constexpr (counted)
+        {
+            // Without a branch, which would be mispredicted half the time
+            const uint64_t word = words[bit / 64];
+            const uint64_t isSet = (word >> (bit % 64)) & 1;
+            words[bit / 64] = word & ~(uint64_t{1} << (bit % 64));
+            blockCounts[bit / (64 * blockWords)] -= isSet;
+            total -= isSet;
+        }
+        else
+        {
+            words[bit / 64] &= ~(uint64_t{1} << (bit % 64));
+        }
+    }
+
+    template<bool counted>
+    void clearMultiples(uint64_t prime)
+    {
+        uint64_t multiple = std::max(prime * prime, (low + prime - 1) / prime * prime);
+        if (multiple % 2 == 0)
+        {
+            multiple += prime;
+        }
+        for (uint64_t bit = (multiple - low) / 2; bit < 64 * segmentWords; bit += prime)
+        {
+            clear<counted>(bit);
+        }
+    }
+
+    inline __attribute__((always_inline)) void updateCounts()
+    {
+        if (countsValid)
+        {
+            return;
+        }
+        total = 0;
+        for (size_t block = 0; block < blockCounts.size(); ++block)
+        {
+            uint32_t count = 0;
+            for (size_t word = block * blockWords; word < (block + 1) * blockWords; ++word)
+            {
+                count += __builtin_popcountll(words[word]);
+            }
+            blockCounts[block] = count;
+            total += count;
+        }
+        countsValid = true;
+    }
+
+    uint64_t low = 0;
+    uint64_t total = 0;
+    bool countsValid = false;
+    std::vector<uint64_t> words;
+    std::vector<uint32_t> blockCounts;
+};
+
+// What the tasks of both sieves read
+struct Context
+{
+    uint64_t x;
+    uint64_t y;
+    // The primes up to sqrt(x), and the number of them up to y
+    std::vector<uint64_t> primes;
+    size_t a;
+    // Möbius function and least prime factor up to y, 1 having none
+    std::vector<int8_t> mu;
+    std::vector<uint64_t> leastFactor;
+};
+
+// For a task of the special leaves, the sum of its leaves counted from its
+// start, and for each b, the sum of the signs of its leaves and the count
+// of phi(., b) over its segments
+struct LeavesResult
+{
+    int64_t sum = 0;
+    std::vector<int64_t> signs;
+    std::vector<uint64_t> counts;
+};
+
+// Index of the last prime whose leaves can reach low, which is the square
+// of the prime at most x / low
+size_t lastLeafPrime(const Context &context, uint64_t low)
+{
+    if (low == 0)
+    {
+        return context.a - 1;
+    }
+    const uint64_t limit = isqrt(context.x / low);
+    const size_t count = std::upper_bound(context.primes.begin(), context.primes.end(), limit) - context.primes.begin();
+    return std::min(context.a - 1, count);
+}
+
+// The leaves are -mu(m) * phi(x / (m * p), b) for p = primes[b] and the
+// squarefree m of (y / p, y] whose factors are all above p. The quotient
+// is below x / y, and phi(u, b) counts the odd numbers up to u that
+// remain once the segment is crossed off by primes[1] ... primes[b - 1]
+inline __attribute__((always_inline)) void sumLeaves(const Context &context, size_t firstSegment, size_t lastSegment,
+                                                     LeavesResult &result)
+{
+    const uint64_t x = context.x;
+    const uint64_t y = context.y;
+    const std::vector<uint64_t> &primes = context.primes;
+    const size_t maxB = lastLeafPrime(context, firstSegment * segmentSpan);
+    result.signs.assign(maxB + 1, 0);
+    result.counts.assign(maxB + 1, 0);
+
+    OddSegment segment;
+    for (size_t s = firstSegment; s < lastSegment; ++s)
+    {
+        const uint64_t low = s * segmentSpan;
+        const uint64_t high = low + segmentSpan;
+        const size_t lastB = lastLeafPrime(context, low);
+        segment.reset(low);
+        for (size_t b = nbTinyPrimes; b <= lastB; ++b)
+        {
+            const uint64_t p = primes[b];
+            // x / (m * p) is in [low, high) for m in (x / (p * high), x / (p * low)]
+            const uint64_t mHigh = low == 0 ? y : std::min(y, x / (p * low));
+            const uint64_t mLow = std::max(y / p, x / (p * high));
+            OddSegment::Counter counter(segment);
+            if (p * p > y)
+            {
+                // m has a single factor, above p, so it is a prime of
+                // (max(p, mLow), mHigh] and mu(m) is -1
+                const auto from = std::upper_bound(primes.begin() + b + 1, primes.begin() + context.a, std::max(p, mLow));
+                const auto to = std::upper_bound(from, primes.begin() + context.a, mHigh);
+                for (auto m = to; m != from;)
+                {
+                    --m;
+                    result.sum += result.counts[b] + counter.countUpTo(x / (p * *m));
+                }
+                result.signs[b] += to - from;
+            }
+            else
+            {
+                for (uint64_t m = mHigh; m > mLow; --m)
+                {
+                    if (context.mu[m] != 0 && context.leastFactor[m] > p)
+                    {
+                        const int64_t count = result.counts[b] + counter.countUpTo(x / (p * m));
+                        result.sum -= context.mu[m] * count;
+                        result.signs[b] -= context.mu[m];
+                    }
+                }
+            }
+            result.counts[b] += segment.count();
+            if (b < lastB)
+            {
+                segment.crossOff(p);
+            }
+        }
+    }
+}
+
+__attribute__((target("popcnt")))
+void sumLeavesPopcnt(const Context &context, size_t firstSegment, size_t lastSegment, LeavesResult &result)
+{
+    sumLeaves(context, firstSegment, lastSegment, result);
+}
+
+void sumLeavesGeneric(const Context &context, size_t firstSegment, size_t lastSegment, LeavesResult &result)
+{
+    sumLeaves(context, firstSegment, lastSegment, result);
+}
+
+// Sum of the special leaves of the primes from nbTinyPrimes on
+int64_t specialLeaves(WorkerPool &pool, const Context &context)
+{
+    const uint64_t end = context.x / context.y + 1;
+    const size_t nbSegments = (end + segmentSpan - 1) / segmentSpan;
+    const size_t nbTasks = (nbSegments + segmentsPerTask - 1) / segmentsPerTask;
+    static const bool hasPopcnt = __builtin_cpu_supports("popcnt");
+
+    std::vector<LeavesResult> results(nbTasks);
+    pool.run(nbTasks, [&](size_t task)
+    {
+        const size_t first = task * segmentsPerTask;
+        const size_t last = std::min(nbSegments, first + segmentsPerTask);
+        if (hasPopcnt)
+        {
+            sumLeavesPopcnt(context, first, last, results[task]);
+        }
+        else
+        {
+            sumLeavesGeneric(context, first, last, results[task]);
+        }
+    });
+
+    // Counts of phi(., b) below the current task
+    std::vector<uint64_t> before(context.a, 0);
+    int64_t sum = 0;
+    for (const LeavesResult &result : results)
+    {
+        sum += result.sum;
+        for (size_t b = nbTinyPrimes; b < result.counts.size(); ++b)
+        {
+            sum += result.signs[b] * static_cast<int64_t>(before[b]);
+            before[b] += result.counts[b];
+        }
+    }
+    return sum;
+}
+
+// For a task of P2, the sum of pi(x / p) counted from its start, the
+// number of primes p, and the number of primes in its segments
+struct QuotientsResult
+{
+    uint64_t sum = 0;
+    uint64_t nbQuotients = 0;
+    uint64_t count = 0;
+};
+
+// The quotients x / p are in [start, x / y], and sieved by the primes up
+// to sqrt(x / y)
+inline __attribute__((always_inline)) void sumQuotients(const Context &context, uint64_t start, size_t firstSegment,
+                                                        size_t lastSegment, QuotientsResult &result)
+{
+    const uint64_t x = context.x;
+    const std::vector<uint64_t> &primes = context.primes;
+
+    OddSegment segment;
+    for (size_t s = firstSegment; s < lastSegment; ++s)
+    {
+        const uint64_t low = start + s * segmentSpan;
+        const uint64_t high = low + segmentSpan;
+        segment.reset(low);
+        segment.crossOffAll(primes.begin() + nbTinyPrimes, std::upper_bound(primes.begin(), primes.end(), isqrt(high - 1)));
+
+        // The primes p of (y, sqrt(x)] with x / p in [low, high), by
+        // increasing quotient
+        const auto from = std::upper_bound(primes.begin() + context.a, primes.end(), x / high);
+        const auto to = std::upper_bound(from, primes.end(), x / low);
+        OddSegment::Counter counter(segment);
+        for (auto p = to; p != from;)
+        {
+            --p;
+            result.sum += result.count + counter.countUpTo(x / *p);
+            ++result.nbQuotients;
+        }
+        result.count += segment.count();
+    }
+}
+
+__attribute__((target("popcnt")))
+void sumQuotientsPopcnt(const Context &context, uint64_t start, size_t firstSegment, size_t lastSegment,
+                        QuotientsResult &result)
+{
+    sumQuotients(context, start, firstSegment, lastSegment, result);
+}
+
+void sumQuotientsGeneric(const Context &context, uint64_t start, size_t firstSegment, size_t lastSegment,
+                         QuotientsResult &result)
+{
+    sumQuotients(context, start, firstSegment, lastSegment, result);
+}
+
+// Sum of pi(x / p) for the primes p in (y, sqrt(x)]
+uint64_t sumPiOfQuotients(WorkerPool &pool, const Context &context)
+{
+    // pi(start - 1) comes from the primes up to sqrt(x)
+    const uint64_t start = isqrt(context.x) / 16 * 16;
+    const uint64_t end = context.x / context.y + 1;
+    const size_t nbSegments = end > start ? (end - start + segmentSpan - 1) / segmentSpan : 0;
+    const size_t nbTasks = (nbSegments + segmentsPerTask - 1) / segmentsPerTask;
+    static const bool hasPopcnt = __builtin_cpu_supports("popcnt");
+
+    std::vector<QuotientsResult> results(nbTasks);
+    pool.run(nbTasks, [&](size_t task)
+    {
+        const size_t first = task * segmentsPerTask;
+        const size_t last = std::min(nbSegments, first + segmentsPerTask);
+        if (hasPopcnt)
+        {
+            sumQuotientsPopcnt(context, start, first, last, results[task]);
+        }
+        else
+        {
+            sumQuotientsGeneric(context, start, first, last, results[task]);
+        }
+    });
+
+    uint64_t before = std::lower_bound(context.primes.begin(), context.primes.end(), start) - context.primes.begin();
+    uint64_t sum = 0;
+    for (const QuotientsResult &result : results)
+    {
+        sum += result.sum + result.nbQuotients * before;
+        before += result.count;
+    }
+    return sum;
+}
+
+// Largest integer whose cube is at most n
+uint64_t icbrt(uint64_t n)
+{
+    uint64_t root = static_cast<uint64_t>(std::cbrt(static_cast<double>(n)));
+    while (root * root * root > n)
+    {
+        --root;
+    }
+    while ((root + 1) * (root + 1) * (root + 1) <= n)
+    {
+        ++root;
+    }
+    return root;
+}
+
+} // namespace
+
+PrimeCounter::PrimeCounter(size_t nbThreads)
+    : nbThreads(nbThreads == 0 ? 1 : nbThreads), pool(this->nbThreads)
+{
+}
+
+uint64_t PrimeCounter::pi(uint64_t x)
+{
+    SegmentedSieve sieve(1);
+    if (x < sieveLimit)
+    {
+        return sieve.countPrimes(0, x + 1);
+    }
+
+    // A larger y moves work from the sieves, which reach x / y, to the
+    // special leaves, whose number grows as pi(y)^2. y stays above x^(1/3),
+    // so that no number up to x has three factors above y. The factor was
+    // measured best from 1 at 1e10 to 3 at 1e15
+    const double alpha = std::max(1.0, (std::log10(static_cast<double>(x)) - 9) / 2);
+    Context context;
+    context.x = x;
+    context.y = static_cast<uint64_t>(alpha * icbrt(x));
+    context.primes = sieve.primes(0, isqrt(x) + 1);
+    context.a = std::upper_bound(context.primes.begin(), context.primes.end(), context.y) - context.primes.begin();
+
+    const uint64_t y = context.y;
+    const size_t a = context.a;
+    context.mu.assign(y + 1, 1);
+    context.leastFactor.assign(y + 1, 0);
+    for (size_t i = 0; i < a; ++i)
+    {
+        const uint64_t p = context.primes[i];
+        for (uint64_t n = p; n <= y; n += p)
+        {
+            if (context.leastFactor[n] == 0)
+            {
+                context.leastFactor[n] = p;
+            }
+            context.mu[n] = -context.mu[n];
+        }
+        for (uint64_t n = p * p; n <= y; n += p * p)
+        {
+            context.mu[n] = 0;
+        }
+    }
+    context.leastFactor[1] = UINT64_MAX;
+
+    // Ordinary leaves mu(n) * phi(x / n, 0), and the special leaves of the
+    // tiny primes, with the same bounds as in sumLeaves()
+    int64_t phi = 0;
+    for (uint64_t n = 1; n <= y; ++n)
+    {
+        phi += context.mu[n] * static_cast<int64_t>(x / n);
+    }
+    const TinyPhi &tinyPhi = TinyPhi::instance();
+    for (size_t b = 0; b < nbTinyPrimes; ++b)
+    {
+        const uint64_t p = context.primes[b];
+        for (uint64_t m = y / p + 1; m <= y; ++m)
+        {
+            if (context.mu[m] != 0 && context.leastFactor[m] > p)
+            {
+                phi -= context.mu[m] * static_cast<int64_t>(tinyPhi.phi(x / (p * m), b));
+            }
+        }
+    }
+    phi += specialLeaves(pool, context);
+
+    // P2(x, a) is the sum over the primes p_i of (y, sqrt(x)] of
+    // pi(x / p_i) - (i - 1), counting from p_1 = 2
+    const uint64_t b = context.primes.size();
+    const uint64_t indices = (b * (b - 1) - a * (a - 1)) / 2;
+    const uint64_t p2 = sumPiOfQuotients(pool, context) - indices;
+
+    return static_cast<uint64_t>(phi) + a - 1 - p2;
+}
@@ -0,0 +1,50 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PRIMECOUNTER_H
+#define PRIMECOUNTER_H
+
+#include "workerpool.h"
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Prime counting function pi(x), by the method of Meissel and Lehmer
+ *
+ * With y a bit above x^(1/3) and a = pi(y),
+ *   pi(x) = phi(x, a) + a - 1 - P2(x, a)
+ * where phi(x, a) counts the numbers up to x without any prime factor up to
+ * y, and P2(x, a) those made of two such factors. phi(x, a) is expanded,
+ * following Lagarias, Miller and Odlyzko, into the ordinary leaves, summed
+ * directly, and the special leaves phi(x / n, b), read from a segmented
+ * sieve of [0, x / y) while it is sieved by the first primes. P2(x, a)
+ * sums pi(x / p) over the primes p between y and sqrt(x), read from a
+ * segmented sieve of [sqrt(x), x / y).
+ *
+ * Both sieves take O(x^(2/3)) time instead of O(x) for a whole sieve, and
+ * O(x^(1/3)) memory per thread. Their segments are shared among the threads
+ * of a WorkerPool: each thread counts from the start of its segments, and
+ * the counts of the previous segments are added once all are done.
+ */
+class PrimeCounter
+{
+public:
+    /**
+     * @brief Construct a counter
+     * @param nbThreads Number of threads sieving the segments
+     */
+    explicit PrimeCounter(size_t nbThreads);
+
+    /**
+     * @brief Number of primes up to x, x included
+     *
+     * The primes up to sqrt(x) are kept in memory, about 16 MB for 1e15.
+     */
+    uint64_t pi(uint64_t x);
+
+private:
+    size_t nbThreads;
+    WorkerPool pool;
+};
+
+#endif // PRIMECOUNTER_H
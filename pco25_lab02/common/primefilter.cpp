@@ -0,0 +1,214 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "primefilter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Cannot read the size of " + path + ": " + std::strerror(errno));
+        }
+        length = static_cast<size_t>(status.st_size);
+        if (length == 0)
+        {
+            return;
+        }
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Cannot map " + path + ": " + std::strerror(errno));
+        }
+        data = static_cast<const char *>(address);
+        madvise(address, length, MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile()
+    {
+        if (data != nullptr)
+        {
+            munmap(const_cast<char *>(data), length);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Gives back the pages of [data, end) that are entirely before end
+    void release(const char *end)
+    {
+        const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t bytes = static_cast<size_t>(end - data) / pageSize * pageSize;
+        if (bytes > released)
+        {
+            madvise(const_cast<char *>(data) + released, bytes - released, MADV_DONTNEED);
+            released = bytes;
+        }
+    }
+
+    const char *data = nullptr;
+    size_t length = 0;
+
+private:
+    int fd = -1;
+    size_t released = 0;
+};
+
+} // namespace
+
+PrimeFilter::PrimeFilter(PrimeNumberDetectorInterface &detector, size_t nbThreads, size_t chunkNumbers)
+    : detector(detector), nbThreads(nbThreads == 0 ? 1 : nbThreads),
+      chunkBytes(std::max<size_t>(chunkNumbers, 1) * sizeof(uint64_t)), pool(this->nbThreads)
+{
+}
+
+PrimeFilter::Statistics PrimeFilter::run(const std::string &inputPath, Format format, FILE *output)
+{
+    const auto start = std::chrono::steady_clock::now();
+    MappedFile input(inputPath);
+    const char *const end = input.data + input.length;
+    // A binary file ending with an incomplete number ignores it
+    const char *const usableEnd = format == Format::Binary ? input.data + input.length / sizeof(uint64_t) * sizeof(uint64_t) : end;
+
+    // Two chunks per thread, so that a thread finishing early finds work
+    std::vector<Chunk> chunks(nbThreads * 2);
+    Statistics statistics;
+    const char *position = input.data;
+
+    while (position < usableEnd)
+    {
+        size_t nbChunks = 0;
+        for (; nbChunks < chunks.size() && position < usableEnd; ++nbChunks)
+        {
+            const char *chunkEnd = position + std::min<size_t>(chunkBytes, usableEnd - position);
+            if (format == Format::Text)
+            {
+                // A number is never split between two chunks
+                while (chunkEnd < end && *chunkEnd >= '0' && *chunkEnd <= '9')
+                {
+                    ++chunkEnd;
+                }
+            }
+            chunks[nbChunks].begin = position;
+            chunks[nbChunks].end = chunkEnd;
+            position = chunkEnd;
+        }
+
+        pool.run(nbChunks, [&](size_t i)
+        {
+            processChunk(chunks[i], format);
+        });
+
+        for (size_t i = 0; i < nbChunks; ++i)
+        {
+            const std::string &text = chunks[i].output;
+            if (!text.empty() && std::fwrite(text.data(), 1, text.size(), output) != text.size())
+            {
+                throw std::runtime_error(std::string("Cannot write the output: ") + std::strerror(errno));
+            }
+            statistics.nbNumbers += chunks[i].numbers.size();
+            statistics.nbPrimes += chunks[i].nbPrimes;
+        }
+        input.release(position);
+    }
+
+    if (std::fflush(output) != 0)
+    {
+        throw std::runtime_error(std::string("Cannot write the output: ") + std::strerror(errno));
+    }
+    statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return statistics;
+}
+
+void PrimeFilter::processChunk(Chunk &chunk, Format format)
+{
+    chunk.numbers.clear();
+    chunk.output.clear();
+    chunk.nbPrimes = 0;
+
+    if (format == Format::Binary)
+    {
+        const size_t count = static_cast<size_t>(chunk.end - chunk.begin) / sizeof(uint64_t);
+        chunk.numbers.resize(count);
+        std::memcpy(chunk.numbers.data(), chunk.begin, count * sizeof(uint64_t));
+    }
+    else
+    {
+        // Numbers too large for 64 bits are skipped
+        for (const char *p = chunk.begin; p < chunk.end;)
+        {
+            if (*p < '0' || *p > '9')
+            {
+                ++p;
+                continue;
+            }
+            uint64_t number;
+            const std::from_chars_result parsed = std::from_chars(p, chunk.end, number);
+            if (parsed.ec == std::errc())
+            {
+                chunk.numbers.push_back(number);
+            }
+            p = parsed.ptr;
+            while (p < chunk.end && *p >= '0' && *p <= '9')
+            {
+                ++p;
+            }
+        }
+    }
+
+    const size_t count = chunk.numbers.size();
+    if (chunk.resultsCapacity < count)
+    {
+        chunk.results.reset(new bool[count]);
+        chunk.resultsCapacity = count;
+    }
+    detector.isPrimeBatch(chunk.numbers.data(), chunk.results.get(), count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!chunk.results[i])
+        {
+            continue;
+        }
+        ++chunk.nbPrimes;
+        if (format == Format::Binary)
+        {
+            chunk.output.append(reinterpret_cast<const char *>(&chunk.numbers[i]), sizeof(uint64_t));
+        }
+        else
+        {
+            char buffer[24];
+            const std::to_chars_result written = std::to_chars(buffer, buffer + sizeof(buffer) - 1, chunk.numbers[i]);
+            *written.ptr = '\n';
+            chunk.output.append(buffer, written.ptr + 1);
+        }
+    }
+}
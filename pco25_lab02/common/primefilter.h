@@ -0,0 +1,91 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PRIMEFILTER_H
+#define PRIMEFILTER_H
+
+#include "primenumberdetector.h"
+#include "workerpool.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Extracts the primes of a file of numbers
+ *
+ * The input file is memory-mapped and cut into chunks. The threads of a
+ * WorkerPool parse the chunks and test their numbers with isPrimeBatch(),
+ * a few chunks at a time, then the primes of these chunks are written in
+ * the order of the input. The pages of the file already processed are
+ * released, so that the memory used stays bounded whatever the size of
+ * the file.
+ *
+ * The detector is shared by the threads, so it must accept concurrent
+ * calls, which is the case of all the single-threaded detectors.
+ */
+class PrimeFilter
+{
+public:
+    /**
+     * @brief Format of the input, and of the output
+     */
+    enum class Format
+    {
+        // 64-bit numbers in the byte order of the machine
+        Binary,
+        // Decimal numbers, separated by any other character. The output
+        // has one number per line
+        Text
+    };
+
+    struct Statistics
+    {
+        uint64_t nbNumbers = 0;
+        uint64_t nbPrimes = 0;
+        double seconds = 0;
+    };
+
+    /**
+     * @brief Construct a filter
+     * @param detector The detector deciding which numbers are kept
+     * @param nbThreads Number of threads processing the chunks
+     * @param chunkNumbers Size of a chunk, in numbers for a binary input and
+     *        in multiples of 8 bytes for a text input
+     */
+    PrimeFilter(PrimeNumberDetectorInterface &detector, size_t nbThreads, size_t chunkNumbers = 1 << 16);
+
+    /**
+     * @brief Write the primes of a file
+     * @param inputPath The file to read
+     * @param format The format of the input and of the output
+     * @param output Where the primes are written
+     * @return Counts and duration of the processing
+     * @throws std::runtime_error if the input cannot be read or the output
+     *         cannot be written
+     */
+    Statistics run(const std::string &inputPath, Format format, FILE *output);
+
+private:
+    struct Chunk
+    {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        std::vector<uint64_t> numbers;
+        std::unique_ptr<bool[]> results;
+        size_t resultsCapacity = 0;
+        std::string output;
+        uint64_t nbPrimes = 0;
+    };
+
+    void processChunk(Chunk &chunk, Format format);
+
+    PrimeNumberDetectorInterface &detector;
+    size_t nbThreads;
+    size_t chunkBytes;
+    WorkerPool pool;
+};
+
+#endif // PRIMEFILTER_H
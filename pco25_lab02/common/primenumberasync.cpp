@@ -0,0 +1,137 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "primenumberasync.h"
+
+#include <algorithm>
+#include <iterator>
+
+PrimeNumberDetectorAsync::PrimeNumberDetectorAsync(size_t nbThreads, size_t maxBatch)
+    : nbThreads(nbThreads == 0 ? 1 : nbThreads), maxBatch(std::max<size_t>(maxBatch, 1)),
+      detector(this->nbThreads, PrimeNumberDetectorMultiThread::Scheduling::Dynamic,
+               PrimeNumberDetectorMultiThread::Kernel::Wheel)
+{
+    dispatcher = std::make_unique<PcoThread>(&PrimeNumberDetectorAsync::dispatcherLoop, this);
+}
+
+PrimeNumberDetectorAsync::~PrimeNumberDetectorAsync()
+{
+    mutex.lock();
+    stopping = true;
+    requestAvailable.notifyOne();
+    mutex.unlock();
+
+    dispatcher->join();
+}
+
+PcoFuture<bool> PrimeNumberDetectorAsync::submit(uint64_t number)
+{
+    Request request{number, PcoPromise<bool>()};
+    PcoFuture<bool> future = request.promise.getFuture();
+
+    mutex.lock();
+    pending.push_back(std::move(request));
+    if (pending.size() == 1)
+    {
+        // Otherwise the dispatcher has already been woken up
+        requestAvailable.notifyOne();
+    }
+    mutex.unlock();
+    return future;
+}
+
+bool PrimeNumberDetectorAsync::isPrime(uint64_t number)
+{
+    return submit(number).get();
+}
+
+uint64_t PrimeNumberDetectorAsync::nbBatches() const
+{
+    mutex.lock();
+    const uint64_t result = batches;
+    mutex.unlock();
+    return result;
+}
+
+void PrimeNumberDetectorAsync::dispatcherLoop()
+{
+    std::vector<Request> batch;
+    mutex.lock();
+    while (true)
+    {
+        while (!stopping && pending.empty())
+        {
+            requestAvailable.wait(&mutex);
+        }
+        // The numbers already submitted are tested before stopping
+        if (pending.empty())
+        {
+            break;
+        }
+
+        // The oldest numbers first, the others wait for the next batch
+        const size_t count = std::min(pending.size(), maxBatch);
+        batch.assign(std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.begin() + count));
+        pending.erase(pending.begin(), pending.begin() + count);
+        ++batches;
+        mutex.unlock();
+
+        testBatch(batch);
+        batch.clear();
+        mutex.lock();
+    }
+    mutex.unlock();
+}
+
+void PrimeNumberDetectorAsync::testBatch(std::vector<Request> &batch)
+{
+    std::vector<uint64_t> numbers;
+    std::vector<size_t> indices;
+    std::vector<size_t> largeIndices;
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (batch[i].promise.isCancelled())
+        {
+            continue;
+        }
+        if (batch[i].number < maxSmallNumber)
+        {
+            numbers.push_back(batch[i].number);
+            indices.push_back(i);
+        }
+        else
+        {
+            largeIndices.push_back(i);
+        }
+    }
+
+    // With at least one large number per thread, the threads are all busy
+    // without splitting the divisors
+    if (largeIndices.size() >= nbThreads)
+    {
+        for (size_t i : largeIndices)
+        {
+            numbers.push_back(batch[i].number);
+            indices.push_back(i);
+        }
+        largeIndices.clear();
+    }
+
+    if (!numbers.empty())
+    {
+        std::unique_ptr<bool[]> results(new bool[numbers.size()]);
+        detector.isPrimeBatch(numbers.data(), results.get(), numbers.size());
+        for (size_t k = 0; k < numbers.size(); ++k)
+        {
+            batch[indices[k]].promise.setValue(results[k]);
+        }
+    }
+
+    for (size_t i : largeIndices)
+    {
+        // Cancelled meanwhile, while the previous numbers were tested
+        if (!batch[i].promise.isCancelled())
+        {
+            batch[i].promise.setValue(detector.isPrime(batch[i].number));
+        }
+    }
+}
@@ -0,0 +1,96 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PRIMENUMBERASYNC_H
+#define PRIMENUMBERASYNC_H
+
+#include "primenumberdetector.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <pcosynchro/pcothread.h>
+#include <pcosynchro/pcomutex.h>
+#include <pcosynchro/pcoconditionvariable.h>
+#include <pcosynchro/pcofuture.h>
+
+/**
+ * @brief Asynchronous front-end of PrimeNumberDetectorMultiThread
+ *
+ * With PrimeNumberDetectorMultiThread, each call to isPrime() uses all the
+ * threads of the pool, and concurrent calls are executed one after the
+ * other. Here, the callers only queue their numbers with submit(). A
+ * dispatcher thread takes all the numbers queued while it was busy as one
+ * batch. Small numbers, and the large ones when there are enough of them
+ * to keep every thread busy, go through isPrimeBatch(), one number per
+ * thread. The remaining large numbers are tested one at a time by isPrime(),
+ * which splits their divisors among the threads.
+ *
+ * A number submitted while the dispatcher is idle is tested at once, there
+ * is no delay to wait for other numbers.
+ */
+class PrimeNumberDetectorAsync : public PrimeNumberDetectorInterface
+{
+public:
+    /**
+     * @brief Construct the detector and start its dispatcher
+     * @param nbThreads Number of threads testing the numbers, the
+     *        dispatcher included
+     * @param maxBatch Maximum number of numbers tested as one batch
+     */
+    explicit PrimeNumberDetectorAsync(size_t nbThreads, size_t maxBatch = 1024);
+
+    /**
+     * @brief Test the numbers already submitted, then stop the dispatcher
+     */
+    ~PrimeNumberDetectorAsync() override;
+
+    PrimeNumberDetectorAsync(const PrimeNumberDetectorAsync &) = delete;
+    PrimeNumberDetectorAsync &operator=(const PrimeNumberDetectorAsync &) = delete;
+
+    /**
+     * @brief Queue a number to test
+     * @return A future getting the result of the test. A cancelled future
+     *         is skipped if its batch has not started yet
+     */
+    PcoFuture<bool> submit(uint64_t number);
+
+    /**
+     * @brief Same as submit(number).get()
+     */
+    bool isPrime(uint64_t number) override;
+
+    /**
+     * @brief Number of batches tested so far
+     */
+    uint64_t nbBatches() const;
+
+private:
+    struct Request
+    {
+        uint64_t number;
+        PcoPromise<bool> promise;
+    };
+
+    // Below this number, the divisors of a number are not worth splitting,
+    // as in PrimeNumberDetectorMultiThread
+    static const uint64_t maxSmallNumber = uint64_t{1} << 32;
+
+    void dispatcherLoop();
+    void testBatch(std::vector<Request> &batch);
+
+    size_t nbThreads;
+    size_t maxBatch;
+    PrimeNumberDetectorMultiThread detector;
+
+    mutable PcoMutex mutex;
+    PcoConditionVariable requestAvailable{false};
+    std::vector<Request> pending;
+    uint64_t batches = 0;
+    bool stopping = false;
+
+    // Started last, once everything it uses is constructed
+    std::unique_ptr<PcoThread> dispatcher;
+};
+
+#endif // PRIMENUMBERASYNC_H
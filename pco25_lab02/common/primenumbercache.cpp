@@ -0,0 +1,146 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "primenumbercache.h"
+
+#include <algorithm>
+
+namespace
+{
+
+size_t roundUpPowerOfTwo(size_t value)
+{
+    size_t power = 1;
+    while (power < value)
+    {
+        power <<= 1;
+    }
+    return power;
+}
+
+} // namespace
+
+PrimeNumberDetectorCache::PrimeNumberDetectorCache(PrimeNumberDetectorInterface &detector, size_t capacity, size_t nbShards)
+    : detector(detector), shardBits(0)
+{
+    nbShards = roundUpPowerOfTwo(std::max<size_t>(nbShards, 1));
+    while ((size_t{1} << shardBits) < nbShards)
+    {
+        ++shardBits;
+    }
+    // Each shard holds at least one probe window
+    const size_t shardSize = std::max(roundUpPowerOfTwo(capacity) / nbShards, probeWindow);
+    slotMask = shardSize - 1;
+
+    shards.reserve(nbShards);
+    for (size_t i = 0; i < nbShards; ++i)
+    {
+        shards.push_back(std::make_unique<Shard>());
+        shards.back()->entries.resize(shardSize);
+    }
+}
+
+bool PrimeNumberDetectorCache::isPrime(uint64_t number)
+{
+    const uint64_t h = hash(number);
+    // The high bits select the shard, the low bits the slot
+    Shard &shard = *shards[shardBits == 0 ? 0 : h >> (64 - shardBits)];
+    const size_t first = static_cast<size_t>(h) & slotMask;
+
+    shard.mutex.lock();
+    for (size_t i = 0; i < probeWindow; ++i)
+    {
+        Entry &entry = shard.entries[(first + i) & slotMask];
+        if (entry.used && entry.number == number)
+        {
+            entry.referenced = true;
+            const bool prime = entry.prime;
+            ++shard.hits;
+            shard.mutex.unlock();
+            return prime;
+        }
+    }
+    ++shard.misses;
+    shard.mutex.unlock();
+
+    const bool prime = detector.isPrime(number);
+
+    shard.mutex.lock();
+    insert(shard, first, number, prime);
+    shard.mutex.unlock();
+    return prime;
+}
+
+uint64_t PrimeNumberDetectorCache::hits() const
+{
+    uint64_t total = 0;
+    for (const std::unique_ptr<Shard> &shard : shards)
+    {
+        shard->mutex.lock();
+        total += shard->hits;
+        shard->mutex.unlock();
+    }
+    return total;
+}
+
+uint64_t PrimeNumberDetectorCache::misses() const
+{
+    uint64_t total = 0;
+    for (const std::unique_ptr<Shard> &shard : shards)
+    {
+        shard->mutex.lock();
+        total += shard->misses;
+        shard->mutex.unlock();
+    }
+    return total;
+}
+
+uint64_t PrimeNumberDetectorCache::hash(uint64_t number)
+{
+    // Finalizer of MurmurHash3, which spreads consecutive numbers
+    number ^= number >> 33;
+    number *= 0xff51afd7ed558ccdULL;
+    number ^= number >> 33;
+    number *= 0xc4ceb9fe1a85ec53ULL;
+    number ^= number >> 33;
+    return number;
+}
+
+void PrimeNumberDetectorCache::insert(Shard &shard, size_t first, uint64_t number, bool prime)
+{
+    // Another thread may have stored the number meanwhile, and a free slot
+    // is used before evicting anything
+    Entry *victim = nullptr;
+    for (size_t i = 0; i < probeWindow; ++i)
+    {
+        Entry &entry = shard.entries[(first + i) & slotMask];
+        if (entry.used && entry.number == number)
+        {
+            return;
+        }
+        if (!entry.used && victim == nullptr)
+        {
+            victim = &entry;
+        }
+    }
+
+    // Clock within the window: the hand skips, and clears, the referenced
+    // entries. After a full turn every entry has been cleared
+    while (victim == nullptr)
+    {
+        Entry &entry = shard.entries[(first + shard.clockHand) & slotMask];
+        shard.clockHand = (shard.clockHand + 1) % probeWindow;
+        if (entry.referenced)
+        {
+            entry.referenced = false;
+        }
+        else
+        {
+            victim = &entry;
+        }
+    }
+
+    victim->number = number;
+    victim->used = true;
+    victim->prime = prime;
+    victim->referenced = false;
+}
@@ -0,0 +1,85 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PRIMENUMBERCACHE_H
+#define PRIMENUMBERCACHE_H
+
+#include "primenumberdetector.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <pcosynchro/pcomutex.h>
+
+/**
+ * @brief Detector remembering the results of another detector
+ *
+ * The results are stored in a table of bounded size, split into shards
+ * protected by their own mutex, so that threads testing different numbers
+ * rarely wait for each other. Within a shard, a number can only be stored
+ * in a small window of slots following its hash. When the window is full,
+ * a slot is reused with the clock algorithm: the slots that have been read
+ * since the last eviction get a second chance.
+ *
+ * The wrapped detector is called without any lock held, so it must accept
+ * concurrent calls when the cache is used by several threads. All the
+ * detectors of primenumberdetector.h do, but PrimeNumberDetectorMultiThread
+ * runs the calls that use its pool one after the other: concurrent callers
+ * only gain from it for numbers small enough to be tested by the caller.
+ */
+class PrimeNumberDetectorCache : public PrimeNumberDetectorInterface
+{
+public:
+    /**
+     * @brief Construct a cache in front of a detector
+     * @param detector The detector computing the results, which has to
+     *        outlive the cache
+     * @param capacity Maximum number of results kept, rounded up to a power
+     *        of two
+     * @param nbShards Number of independent parts of the table, rounded up
+     *        to a power of two
+     */
+    PrimeNumberDetectorCache(PrimeNumberDetectorInterface &detector, size_t capacity, size_t nbShards = 64);
+
+    bool isPrime(uint64_t number) override;
+
+    /**
+     * @brief Number of calls answered from the cache
+     */
+    uint64_t hits() const;
+
+    /**
+     * @brief Number of calls forwarded to the detector
+     */
+    uint64_t misses() const;
+
+private:
+    static const size_t probeWindow = 8;
+
+    struct Entry
+    {
+        uint64_t number = 0;
+        bool used = false;
+        bool prime = false;
+        bool referenced = false;
+    };
+
+    struct Shard
+    {
+        mutable PcoMutex mutex;
+        std::vector<Entry> entries;
+        size_t clockHand = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    static uint64_t hash(uint64_t number);
+    void insert(Shard &shard, size_t first, uint64_t number, bool prime);
+
+    PrimeNumberDetectorInterface &detector;
+    std::vector<std::unique_ptr<Shard>> shards;
+    unsigned shardBits;
+    size_t slotMask;
+};
+
+#endif // PRIMENUMBERCACHE_H
@@ -1,8 +1,93 @@
 // Authors: Nicolas Reymond, Nadia Cattin
 
 #include "primenumberdetector.h"
+#include "smallprimes.h"
+#include "uint128.h"
 
-static PcoMutex mutex;
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/**
+ * @brief First number coprime to 210 that is >= start
+ * @param k Receives the index of its residue in the wheel
+ */
+uint64_t firstWheelDivisor(uint64_t start, size_t &k)
+{
+    uint64_t divisor = start - start % wheelModulus;
+    k = wheelNext[start % wheelModulus];
+    if (k == wheelSize)
+    {
+        divisor += wheelModulus;
+        k = 0;
+    }
+    return divisor + wheelResidues[k];
+}
+
+/**
+ * @brief Look for a divisor of number in [start, end], start >= 3
+ * @param stop Called after each divisor, the search is abandoned when it
+ *        returns true. It should be cheap enough to inline, and may only
+ *        check a condition every few calls
+ * @return true if a divisor has been found
+ */
+template<typename StopCondition>
+bool hasWheelDivisor(uint64_t number, uint64_t start, uint64_t end, StopCondition stop)
+{
+    // The primes of the table first
+    const uint64_t lastPrime = smallPrimes.back();
+    if (start <= lastPrime)
+    {
+        for (auto it = std::lower_bound(smallPrimes.begin(), smallPrimes.end(), start);
+             it != smallPrimes.end() && *it <= end; ++it)
+        {
+            if (number % *it == 0)
+            {
+                return true;
+            }
+            if (stop())
+            {
+                return false;
+            }
+        }
+        start = lastPrime + 1;
+    }
+
+    // Then the numbers coprime to 210
+    size_t k;
+    uint64_t divisor = firstWheelDivisor(start, k);
+    while (divisor <= end)
+    {
+        if (number % divisor == 0)
+        {
+            return true;
+        }
+        divisor += wheelGaps[k];
+        k = (k + 1 == wheelSize) ? 0 : k + 1;
+        if (stop())
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+void PrimeNumberDetectorInterface::isPrimeBatch(const uint64_t *in, bool *out, size_t n)
+{
+    SmallPrimeFilter::filter(in, out, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (out[i])
+        {
+            out[i] = isPrime(in[i]);
+        }
+    }
+}
 
 bool PrimeNumberDetector::isPrime(uint64_t number)
 {
@@ -10,7 +95,7 @@ bool PrimeNumberDetector::isPrime(uint64_t number)
     {
         return false;
     }
-    const uint64_t maxDivisor = static_cast<uint64_t>(std::sqrt(number));
+    const uint64_t maxDivisor = isqrt(number);
 
     for (uint64_t i = 3; i <= maxDivisor; i += 2)
     {
@@ -23,8 +108,44 @@ bool PrimeNumberDetector::isPrime(uint64_t number)
     return true;
 }
 
-PrimeNumberDetectorMultiThread::PrimeNumberDetectorMultiThread(size_t nbThreads)
-    : nbThreads(nbThreads)
+bool PrimeNumberDetectorWheel::isPrime(uint64_t number)
+{
+    if (number < 2 || number % 2 == 0)
+    {
+        return false;
+    }
+    const uint64_t maxDivisor = isqrt(number);
+
+    return !hasWheelDivisor(number, 3, maxDivisor, [] { return false; });
+}
+
+bool PrimeNumberDetectorInverse::isPrime(uint64_t number)
+{
+    if (number < 2 || number % 2 == 0)
+    {
+        return false;
+    }
+    const uint64_t maxDivisor = isqrt(number);
+
+    // smallPrimes[0] is 2
+    for (size_t k = 1; k < nbSmallPrimes && smallPrimes[k] <= maxDivisor; ++k)
+    {
+        if (number * smallPrimeInverses[k] <= smallPrimeLimits[k])
+        {
+            return false;
+        }
+    }
+
+    if (maxDivisor <= smallPrimes.back())
+    {
+        return true;
+    }
+    return !hasWheelDivisor(number, smallPrimes.back() + 1, maxDivisor, [] { return false; });
+}
+
+PrimeNumberDetectorMultiThread::PrimeNumberDetectorMultiThread(size_t nbThreads, Scheduling scheduling, Kernel kernel,
+                                                               ThreadPlacement placement)
+    : nbThreads(nbThreads == 0 ? 1 : nbThreads), scheduling(scheduling), kernel(kernel), pool(nbThreads, placement)
 {
 }
 
@@ -32,59 +153,326 @@ bool PrimeNumberDetectorMultiThread::isPrime(uint64_t number)
 {
     if (number < 2 || number % 2 == 0)
     {
+        return number == 2;
+    }
+
+    const uint64_t maxDivisor = isqrt(number);
+    CancellationToken token;
+
+    if (nbThreads == 1 || maxDivisor < minParallelDivisor)
+    {
+        testRange(number, 3, maxDivisor, kernel, token);
+        return !token.isCancelled();
+    }
+
+    if (scheduling == Scheduling::Dynamic)
+    {
+        // Even, so that every chunk starts on an odd divisor
+        const uint64_t chunk = std::clamp(maxDivisor / (nbThreads * chunksPerThread), minChunk, maxChunk) & ~uint64_t{1};
+        std::atomic<uint64_t> cursor{3};
+
+        pool.run(nbThreads, [&](size_t)
+        {
+            while (!token.isCancelled())
+            {
+                const uint64_t start = cursor.fetch_add(chunk, std::memory_order_relaxed);
+                if (start > maxDivisor)
+                {
+                    break;
+                }
+                testRange(number, start, std::min(start + chunk - 1, maxDivisor), kernel, token);
+            }
+        });
+    }
+    else
+    {
+        const uint64_t step = maxDivisor / nbThreads;
+
+        pool.run(nbThreads, [&](size_t i)
+        {
+            const uint64_t start = 3 + (i * step);
+            const uint64_t end = (i == nbThreads - 1) ? maxDivisor : start + step - 1;
+            testRange(number, start, end, kernel, token);
+        });
+    }
+
+    if (token.isCancelled())
+    {
+        const auto latency = std::chrono::steady_clock::now() - token.cancelTime();
+        cancellationLatency.store(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count(),
+                                  std::memory_order_relaxed);
         return false;
     }
+    return true;
+}
 
-    const uint64_t maxDivisor = static_cast<uint64_t>(std::sqrt(number));
-    const uint64_t step = maxDivisor / nbThreads;
-    bool divisorFound = false;
+std::chrono::nanoseconds PrimeNumberDetectorMultiThread::lastCancellationLatency() const
+{
+    return std::chrono::nanoseconds(cancellationLatency.load(std::memory_order_relaxed));
+}
+
+PrimeNumberDetectorMultiThread::BudgetedResult
+PrimeNumberDetectorMultiThread::isPrimeWithin(uint64_t number, std::chrono::steady_clock::time_point deadline)
+{
+    using Clock = std::chrono::steady_clock;
+    BudgetedResult result{Primality::Composite, 1.0, Stage::SmallPrimes, {}};
+    Clock::time_point stageStart = Clock::now();
+    const auto endStage = [&](Stage stage)
+    {
+        const Clock::time_point now = Clock::now();
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - stageStart);
+        result.stage = stage;
+        result.stageTimes[static_cast<size_t>(stage)] = elapsed;
+        stageMutex.lock();
+        ++stageTotals[static_cast<size_t>(stage)].first;
+        stageTotals[static_cast<size_t>(stage)].second += elapsed;
+        stageMutex.unlock();
+        stageStart = now;
+        return now;
+    };
+    const auto report = [&]
+    {
+        static const char *const names[] = {"prime", "composite", "probably prime"};
+        LOG(LogLevel::Debug) << "isPrimeWithin(" << number << "): " << names[static_cast<int>(result.primality)]
+                             << ", confidence " << result.confidence << ", stages "
+                             << result.stageTimes[0].count() << " ns, " << result.stageTimes[1].count() << " ns, "
+                             << result.stageTimes[2].count() << " ns" << std::endl;
+        return result;
+    };
 
-    std::vector<std::unique_ptr<PcoThread>> threads;
-    threads.reserve(nbThreads);
+    // SmallPrimes: a composite below 2^32 has a divisor below 2^16
+    bool hasSmallFactor = number < 2 || (number % 2 == 0 && number != 2);
+    const uint64_t maxDivisor = isqrt(number);
+    // smallPrimes[0] is 2
+    for (size_t k = 1; !hasSmallFactor && k < nbSmallPrimes && smallPrimes[k] <= maxDivisor; ++k)
+    {
+        hasSmallFactor = number * smallPrimeInverses[k] <= smallPrimeLimits[k];
+    }
+    if (hasSmallFactor || maxDivisor < smallPrimesLimit)
+    {
+        result.primality = hasSmallFactor ? Primality::Composite : Primality::Prime;
+        endStage(Stage::SmallPrimes);
+        return report();
+    }
+    result.primality = Primality::ProbablyPrime;
+    result.confidence = 0.0;
+    if (endStage(Stage::SmallPrimes) >= deadline)
+    {
+        return report();
+    }
 
-    for (uint32_t i = 0; i < nbThreads; ++i)
+    // ProbablePrime: a base proves the number composite, or divides by 4 at
+    // least the probability of a composite passing all of them. Most
+    // composites fail the first base, sparing the Deterministic stage
+    thread_local std::mt19937_64 generator(std::random_device{}());
+    std::uniform_int_distribution<uint64_t> bases(2, number - 2);
+    int rounds = 0;
+    bool passed = true;
+    while (passed && rounds < probablePrimeRounds && (rounds == 0 || Clock::now() < deadline))
     {
-        const uint64_t start = 3 + (i * step);
-        const uint64_t end = (i == nbThreads - 1) ? maxDivisor : start + step - 1;
+        passed = PrimeNumberDetectorMillerRabin::isStrongProbablePrime(number, bases(generator));
+        ++rounds;
+    }
+    if (!passed)
+    {
+        result.primality = Primality::Composite;
+        result.confidence = 1.0;
+        endStage(Stage::ProbablePrime);
+        return report();
+    }
+    result.confidence = 1.0 - std::ldexp(1.0, -2 * rounds);
+    if (endStage(Stage::ProbablePrime) >= deadline)
+    {
+        return report();
+    }
 
-        threads.push_back(std::unique_ptr<PcoThread>(
-            new PcoThread(testRange, number, start, end, std::ref(divisorFound))));
+    // Deterministic: the number has no factor below 2^16, and these bases
+    // are exact for it
+    for (uint64_t base : PrimeNumberDetectorMillerRabin::deterministicBases)
+    {
+        passed = passed && PrimeNumberDetectorMillerRabin::isStrongProbablePrime(number, base);
     }
+    result.primality = passed ? Primality::Prime : Primality::Composite;
+    result.confidence = 1.0;
+    endStage(Stage::Deterministic);
+    return report();
+}
+
+std::pair<uint64_t, std::chrono::nanoseconds> PrimeNumberDetectorMultiThread::stageMetrics(Stage stage) const
+{
+    stageMutex.lock();
+    const std::pair<uint64_t, std::chrono::nanoseconds> totals = stageTotals[static_cast<size_t>(stage)];
+    stageMutex.unlock();
+    return totals;
+}
+
+void PrimeNumberDetectorMultiThread::isPrimeBatch(const uint64_t *in, bool *out, size_t n)
+{
+    SmallPrimeFilter::filter(in, out, n);
 
-    for (std::unique_ptr<PcoThread> &thread : threads)
+    std::vector<size_t> survivors;
+    for (size_t i = 0; i < n; ++i)
     {
-        thread->join();
+        if (out[i])
+        {
+            survivors.push_back(i);
+        }
     }
 
-    return !divisorFound;
+    const size_t nbTasks = std::min(nbThreads, survivors.size());
+    pool.run(nbTasks, [&](size_t task)
+    {
+        // Each thread gets a contiguous part of the survivors
+        const size_t first = survivors.size() * task / nbTasks;
+        const size_t last = survivors.size() * (task + 1) / nbTasks;
+        for (size_t k = first; k < last; ++k)
+        {
+            const uint64_t number = in[survivors[k]];
+            if (number < 2 || number % 2 == 0)
+            {
+                out[survivors[k]] = number == 2;
+                continue;
+            }
+            CancellationToken token;
+            testRange(number, 3, isqrt(number), kernel, token);
+            out[survivors[k]] = !token.isCancelled();
+        }
+    });
 }
 
-void PrimeNumberDetectorMultiThread::testRange(uint64_t n, uint64_t start, uint64_t end, bool &divisorFound)
+void PrimeNumberDetectorMultiThread::testRange(uint64_t n, uint64_t start, uint64_t end, Kernel kernel, CancellationToken &token)
 {
+    uint64_t counter = 0;
+    if (kernel == Kernel::Wheel)
+    {
+        auto stop = [&token, &counter] { return (++counter & (checkInterval - 1)) == 0 && token.isCancelled(); };
+        if (hasWheelDivisor(n, start, end, stop))
+        {
+            token.cancel();
+        }
+        return;
+    }
+
     if (start % 2 == 0)
     {
         start++;
     }
-    int counter = 0;
     for (uint64_t i = start; i <= end; i += 2)
     {
         if (n % i == 0)
         {
-            mutex.lock();
-            divisorFound = true;
-            mutex.unlock();
+            token.cancel();
             return;
         }
         counter++;
-        if (counter % checkInterval == 0)
+        if ((counter & (checkInterval - 1)) == 0 && token.isCancelled())
         {
-            mutex.lock();
-            if (divisorFound)
-            {
-                mutex.unlock();
-                return;
-            }
-            mutex.unlock();
+            return;
         }
     }
-}
\ No newline at end of file
+}
+
+void PrimeNumberDetectorMultiThread::CancellationToken::cancel()
+{
+    // Only the first thread finding a divisor records the time
+    if (!cancelled.exchange(true, std::memory_order_acq_rel))
+    {
+        time = std::chrono::steady_clock::now();
+    }
+}
+
+bool PrimeNumberDetectorMultiThread::CancellationToken::isCancelled() const
+{
+    // The other threads only need to see the flag eventually, and pool.run()
+    // synchronizes them with the caller before the result is read
+    return cancelled.load(std::memory_order_relaxed);
+}
+
+std::chrono::steady_clock::time_point PrimeNumberDetectorMultiThread::CancellationToken::cancelTime() const
+{
+    return time;
+}
+
+bool PrimeNumberDetectorMillerRabin::isPrime(uint64_t number)
+{
+    // Trial division by the bases also handles the small numbers
+    static const uint64_t smallPrimes[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+    if (number < 2)
+    {
+        return false;
+    }
+    for (uint64_t prime : smallPrimes)
+    {
+        if (number % prime == 0)
+        {
+            return number == prime;
+        }
+    }
+    if (number < 41 * 41)
+    {
+        return true;
+    }
+
+    for (uint64_t base : deterministicBases)
+    {
+        if (!isStrongProbablePrime(number, base))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PrimeNumberDetectorMillerRabin::isStrongProbablePrime(uint64_t number, uint64_t base)
+{
+    base %= number;
+    if (base == 0)
+    {
+        return true;
+    }
+
+    // number - 1 = d * 2^s with d odd
+    uint64_t d = number - 1;
+    int s = 0;
+    while (d % 2 == 0)
+    {
+        d /= 2;
+        s++;
+    }
+
+    uint64_t x = powMod(base, d, number);
+    if (x == 1 || x == number - 1)
+    {
+        return true;
+    }
+    for (int i = 1; i < s; i++)
+    {
+        x = mulMod(x, x, number);
+        if (x == number - 1)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t PrimeNumberDetectorMillerRabin::mulMod(uint64_t a, uint64_t b, uint64_t modulus)
+{
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b % modulus);
+}
+
+uint64_t PrimeNumberDetectorMillerRabin::powMod(uint64_t base, uint64_t exponent, uint64_t modulus)
+{
+    uint64_t result = 1;
+    while (exponent > 0)
+    {
+        if (exponent & 1)
+        {
+            result = mulMod(result, base, modulus);
+        }
+        base = mulMod(base, base, modulus);
+        exponent >>= 1;
+    }
+    return result;
+}
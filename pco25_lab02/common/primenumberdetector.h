@@ -4,12 +4,18 @@
 #define PRIMENUMBERDETECTOR_H
 
 #include "logging.h"
+#include "smallprimefilter.h"
+#include "workerpool.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstddef>
 #include <cmath>
-#include <pcosynchro/pcothread.h>
+#include <utility>
 #include <pcosynchro/pcomutex.h>
+#include <pcosynchro/pcothread.h>
 
 /**
  * @brief Interface for prime number detection algorithms
@@ -25,6 +31,18 @@ public:
      * @return true if the number is prime, false otherwise
      */
     virtual bool isPrime(uint64_t number) = 0;
+
+    /**
+     * @brief Check a batch of numbers
+     * @param in The numbers to check
+     * @param out Receives, for each number, the result of isPrime()
+     * @param n Number of numbers in the batch
+     *
+     * The numbers having a small prime factor are first eliminated by
+     * SmallPrimeFilter, for the whole batch at once. isPrime() is only
+     * called on the remaining ones.
+     */
+    virtual void isPrimeBatch(const uint64_t *in, bool *out, size_t n);
 };
 
 /**
@@ -36,24 +54,230 @@ public:
     bool isPrime(uint64_t number) override;
 };
 
+/**
+ * @brief Single-threaded prime number detector using a wheel
+ *
+ * The divisors are first taken from a table of the primes below 2^16, then
+ * among the numbers coprime to 210, instead of among all the odd numbers.
+ * The tables are computed at compile time (see smallprimes.h).
+ */
+class PrimeNumberDetectorWheel : public PrimeNumberDetectorInterface
+{
+public:
+    bool isPrime(uint64_t number) override;
+};
+
+/**
+ * @brief Single-threaded prime number detector dividing by multiplications
+ *
+ * Same divisors as PrimeNumberDetectorWheel, but the divisions by the
+ * primes of the table are replaced by a multiplication and a comparison,
+ * with inverses modulo 2^64 computed at compile time. Beyond the table,
+ * computing the inverse of each divisor costs more than a division, so
+ * the wheel divisors are tested with %.
+ */
+class PrimeNumberDetectorInverse : public PrimeNumberDetectorInterface
+{
+public:
+    bool isPrime(uint64_t number) override;
+};
+
 /**
  * @brief Multi-threaded prime number detector
+ *
+ * The threads are created once, in the constructor, and reused by every
+ * call to isPrime(). Numbers whose divisor range is too small to be worth
+ * splitting are tested by the calling thread alone.
+ *
+ * Concurrent calls are safe, but those that need the pool are executed one
+ * after the other.
  */
 class PrimeNumberDetectorMultiThread : public PrimeNumberDetectorInterface
 {
 public:
+    /**
+     * @brief How the divisors are distributed among the threads
+     */
+    enum class Scheduling
+    {
+        // Each thread gets one of nbThreads equal ranges
+        Static,
+        // The threads take chunks of divisors from a shared cursor, the
+        // smallest divisors first, until the range is exhausted
+        Dynamic
+    };
+
+    /**
+     * @brief Which divisors of a range the threads test
+     */
+    enum class Kernel
+    {
+        // Every odd number
+        Odd,
+        // The small primes, then the numbers coprime to 210, as
+        // PrimeNumberDetectorWheel
+        Wheel
+    };
+
     /**
      * @brief Construct a multi-threaded prime detector
      * @param nbThreads Number of threads to use for detection
+     * @param scheduling How the divisors are distributed among the threads
+     * @param kernel Which divisors the threads test
+     * @param placement On which CPUs the threads of the pool run
      */
-    explicit PrimeNumberDetectorMultiThread(size_t nbThreads);
+    explicit PrimeNumberDetectorMultiThread(size_t nbThreads, Scheduling scheduling = Scheduling::Static,
+                                            Kernel kernel = Kernel::Odd,
+                                            ThreadPlacement placement = ThreadPlacement::None);
 
     bool isPrime(uint64_t number) override;
 
+    /**
+     * @brief Check a batch of numbers, the threads sharing the numbers
+     *
+     * The numbers that pass the small prime filter are split among the
+     * threads, each number being tested by a single thread.
+     */
+    void isPrimeBatch(const uint64_t *in, bool *out, size_t n) override;
+
+    /**
+     * @brief Time between the discovery of a divisor and the return of
+     *        isPrime(), during the last call that used several threads
+     *        and found a divisor
+     *
+     * With concurrent calls, this is the latency of any one of them.
+     */
+    std::chrono::nanoseconds lastCancellationLatency() const;
+
+    /**
+     * @brief Answer of isPrimeWithin()
+     */
+    enum class Primality
+    {
+        // Proven prime
+        Prime,
+        // Proven composite, or below 2
+        Composite,
+        // No factor below 2^16 and none found by the random bases run, but
+        // the deadline came before the Deterministic stage
+        ProbablyPrime
+    };
+
+    /**
+     * @brief Stages of isPrimeWithin(), from the cheapest
+     */
+    enum class Stage
+    {
+        // Trial division by the primes below 2^16, enough below 2^32
+        SmallPrimes,
+        // Strong probable prime tests in a few random bases, which prove
+        // most composites composite
+        ProbablePrime,
+        // Strong probable prime tests in the bases of
+        // PrimeNumberDetectorMillerRabin, exact below 2^64
+        Deterministic
+    };
+    static const size_t nbStages = 3;
+
+    struct BudgetedResult
+    {
+        Primality primality;
+        // 1 for a proven answer. For ProbablyPrime, 1 - 4^-k after k random
+        // bases, the bound of Rabin on the probability of a composite passing
+        double confidence;
+        // The last stage run
+        Stage stage;
+        // Time spent in each stage, indexed by Stage, zero if not run
+        std::array<std::chrono::nanoseconds, nbStages> stageTimes;
+    };
+
+    /**
+     * @brief Check a number, stopping at a deadline
+     *
+     * The first stage always runs. Each next stage starts only if the
+     * deadline is not reached, and each takes a few microseconds at most:
+     * the answer is exact unless the deadline comes first.
+     */
+    BudgetedResult isPrimeWithin(uint64_t number, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Number of runs of a stage and their total time, over all the
+     *        calls to isPrimeWithin()
+     *
+     * The count and the time are read together, so they always describe
+     * the same runs, even during concurrent calls.
+     */
+    std::pair<uint64_t, std::chrono::nanoseconds> stageMetrics(Stage stage) const;
+
 private:
-    static const uint64_t checkInterval = 1000;
+    /**
+     * @brief Cancellation shared by the threads of a single isPrime() call
+     */
+    class CancellationToken
+    {
+    public:
+        // Called when a divisor is found
+        void cancel();
+        bool isCancelled() const;
+        std::chrono::steady_clock::time_point cancelTime() const;
+
+    private:
+        std::atomic<bool> cancelled{false};
+        std::chrono::steady_clock::time_point time;
+    };
+
+    // Random bases tried by the ProbablePrime stage of isPrimeWithin(),
+    // fewer than the bases of the Deterministic stage
+    static const int probablePrimeRounds = 2;
+
+    // Iterations between two checks of the token, a power of two
+    static const uint64_t checkInterval = 256;
+    // Below this largest divisor, dispatching to the pool costs more than testing
+    static const uint64_t minParallelDivisor = 1 << 16;
+    // Dynamic scheduling aims at this many chunks per thread, within bounds
+    static const uint64_t chunksPerThread = 32;
+    static const uint64_t minChunk = 1 << 12;
+    static const uint64_t maxChunk = 1 << 20;
     size_t nbThreads;
-    static void testRange(uint64_t number, uint64_t lower, uint64_t upper, bool &divisorFound);
+    Scheduling scheduling;
+    Kernel kernel;
+    WorkerPool pool;
+    // In nanoseconds, written by the calls that found a divisor, which may
+    // run concurrently
+    std::atomic<int64_t> cancellationLatency{0};
+    // Updated by concurrent calls to isPrimeWithin(), once per stage
+    mutable PcoMutex stageMutex;
+    std::array<std::pair<uint64_t, std::chrono::nanoseconds>, nbStages> stageTotals{};
+    static void testRange(uint64_t number, uint64_t lower, uint64_t upper, Kernel kernel, CancellationToken &token);
+};
+
+/**
+ * @brief Deterministic Miller-Rabin prime number detector
+ *
+ * Runs the strong probable prime test with a set of bases proven to give
+ * no false positive for any 64-bit number, so the answer is exact.
+ * The modular products are computed on 128 bits.
+ */
+class PrimeNumberDetectorMillerRabin : public PrimeNumberDetectorInterface
+{
+public:
+    bool isPrime(uint64_t number) override;
+
+    /**
+     * @brief Strong probable prime test of an odd number for one base
+     * @param number The odd number to test, greater than 2
+     * @param base The base of the test
+     * @return false if the base proves the number composite, true otherwise
+     */
+    static bool isStrongProbablePrime(uint64_t number, uint64_t base);
+
+    // These 7 bases give the exact answer for every number below 2^64
+    // that has no prime factor up to 37
+    static constexpr uint64_t deterministicBases[] = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+private:
+    static uint64_t mulMod(uint64_t a, uint64_t b, uint64_t modulus);
+    static uint64_t powMod(uint64_t base, uint64_t exponent, uint64_t modulus);
 };
 
 #endif // PRIMENUMBERDETECTOR_H
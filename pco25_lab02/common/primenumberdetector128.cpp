@@ -0,0 +1,364 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "primenumberdetector128.h"
+#include "smallprimes.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+// Full product of two 128-bit numbers, from four 64-bit products
+void multiplyFull(uint128 a, uint128 b, uint128 &high, uint128 &low)
+{
+    const uint64_t a0 = static_cast<uint64_t>(a);
+    const uint64_t a1 = static_cast<uint64_t>(a >> 64);
+    const uint64_t b0 = static_cast<uint64_t>(b);
+    const uint64_t b1 = static_cast<uint64_t>(b >> 64);
+    const uint128 p00 = static_cast<uint128>(a0) * b0;
+    const uint128 p01 = static_cast<uint128>(a0) * b1;
+    const uint128 p10 = static_cast<uint128>(a1) * b0;
+    const uint128 p11 = static_cast<uint128>(a1) * b1;
+    // At most 3 * (2^64 - 1), no overflow
+    const uint128 middle = (p00 >> 64) + static_cast<uint64_t>(p01) + static_cast<uint64_t>(p10);
+    low = (middle << 64) | static_cast<uint64_t>(p00);
+    high = p11 + (p01 >> 64) + (p10 >> 64) + (middle >> 64);
+}
+
+/**
+ * @brief Arithmetic modulo an odd 128-bit number, in Montgomery form
+ *
+ * Same reduction as the 64-bit one of the factorizer, with R = 2^128:
+ * the low half of a * b is cancelled by m * n, where m is computed with
+ * the inverse of n modulo 2^128, so only the high halves are subtracted.
+ */
+class Montgomery
+{
+public:
+    explicit Montgomery(uint128 modulus)
+        : modulus(modulus)
+    {
+        // One Newton step doubles the number of correct bits of the inverse
+        const uint128 inverse0 = inverse64(static_cast<uint64_t>(modulus));
+        inverse = inverse0 * (2 - modulus * inverse0);
+
+        // R mod n, then R^2 mod n by doubling it 128 times
+        r = (0 - modulus) % modulus;
+        rSquared = r;
+        for (int i = 0; i < 128; ++i)
+        {
+            rSquared = add(rSquared, rSquared);
+        }
+    }
+
+    uint128 toMontgomery(uint128 value) const
+    {
+        return multiply(value % modulus, rSquared);
+    }
+
+    // Product of two values in Montgomery form, in Montgomery form
+    uint128 multiply(uint128 a, uint128 b) const
+    {
+        uint128 high;
+        uint128 low;
+        multiplyFull(a, b, high, low);
+        uint128 mnHigh;
+        uint128 mnLow;
+        multiplyFull(low * inverse, modulus, mnHigh, mnLow);
+        // The low halves of a * b and m * n are equal
+        return high >= mnHigh ? high - mnHigh : high - mnHigh + modulus;
+    }
+
+    uint128 add(uint128 a, uint128 b) const
+    {
+        return a >= modulus - b ? a - (modulus - b) : a + b;
+    }
+
+    uint128 subtract(uint128 a, uint128 b) const
+    {
+        return a >= b ? a - b : a - b + modulus;
+    }
+
+    // Half of a value, modulo the odd modulus
+    uint128 half(uint128 a) const
+    {
+        // (a + n) / 2 without overflowing, both being odd
+        return a % 2 == 0 ? a / 2 : a / 2 + modulus / 2 + 1;
+    }
+
+    uint128 power(uint128 base, uint128 exponent) const
+    {
+        uint128 result = r;
+        while (exponent != 0)
+        {
+            if (exponent & 1)
+            {
+                result = multiply(result, base);
+            }
+            base = multiply(base, base);
+            exponent >>= 1;
+        }
+        return result;
+    }
+
+    // 1 in Montgomery form
+    uint128 one() const
+    {
+        return r;
+    }
+
+private:
+    uint128 modulus;
+    uint128 inverse;
+    uint128 r;
+    uint128 rSquared;
+};
+
+/**
+ * @brief Products of consecutive small primes, each fitting on 64 bits
+ *
+ * A 128-bit number is reduced once modulo each product, then the remainder
+ * is tested against each prime of the product with its inverse.
+ */
+struct PrimeGroup
+{
+    uint64_t product;
+    size_t first;
+    size_t last;
+};
+
+// Trial division by the primes below this limit
+const uint32_t trialDivisionLimit = 1 << 10;
+
+const std::vector<PrimeGroup> &primeGroups()
+{
+    static const std::vector<PrimeGroup> groups = []
+    {
+        std::vector<PrimeGroup> result;
+        // smallPrimes[0] is 2
+        for (size_t k = 1; k < nbSmallPrimes && smallPrimes[k] < trialDivisionLimit;)
+        {
+            PrimeGroup group{1, k, k};
+            while (group.last < nbSmallPrimes && smallPrimes[group.last] < trialDivisionLimit
+                   && group.product <= UINT64_MAX / smallPrimes[group.last])
+            {
+                group.product *= smallPrimes[group.last];
+                ++group.last;
+            }
+            result.push_back(group);
+            k = group.last;
+        }
+        return result;
+    }();
+    return groups;
+}
+
+} // namespace
+
+PrimeNumberDetector128::PrimeNumberDetector128(size_t nbThreads)
+    : nbThreads(nbThreads == 0 ? 1 : nbThreads), pool(nbThreads)
+{
+}
+
+bool PrimeNumberDetector128::isPrime(uint64_t number)
+{
+    return detector64.isPrime(number);
+}
+
+bool PrimeNumberDetector128::isPrime(uint128 number)
+{
+    if ((number >> 64) == 0)
+    {
+        return detector64.isPrime(static_cast<uint64_t>(number));
+    }
+    if (number % 2 == 0 || hasSmallDivisor(number))
+    {
+        return false;
+    }
+    return isStrongProbablePrime(number, 2) && isStrongLucasProbablePrime(number);
+}
+
+void PrimeNumberDetector128::isPrimeBatch(const uint128 *in, bool *out, size_t n)
+{
+    const size_t nbTasks = std::min(nbThreads, n);
+    pool.run(nbTasks, [&](size_t task)
+    {
+        // Each thread gets a contiguous part of the numbers
+        const size_t first = n * task / nbTasks;
+        const size_t last = n * (task + 1) / nbTasks;
+        for (size_t i = first; i < last; ++i)
+        {
+            out[i] = isPrime(in[i]);
+        }
+    });
+}
+
+bool PrimeNumberDetector128::isStrongProbablePrime(uint128 number, uint128 base)
+{
+    const Montgomery montgomery(number);
+    uint128 d = number - 1;
+    int s = 0;
+    while (d % 2 == 0)
+    {
+        d /= 2;
+        ++s;
+    }
+
+    base %= number;
+    if (base == 0)
+    {
+        return true;
+    }
+    const uint128 one = montgomery.one();
+    const uint128 minusOne = number - one;
+    uint128 x = montgomery.power(montgomery.toMontgomery(base), d);
+    if (x == one || x == minusOne)
+    {
+        return true;
+    }
+    for (int r = 1; r < s; ++r)
+    {
+        x = montgomery.multiply(x, x);
+        if (x == minusOne)
+        {
+            return true;
+        }
+        if (x == one)
+        {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool PrimeNumberDetector128::isStrongLucasProbablePrime(uint128 number)
+{
+    const auto residue = [number](int64_t value)
+    {
+        const uint128 magnitude = static_cast<uint128>(value > 0 ? value : -value) % number;
+        return value >= 0 || magnitude == 0 ? magnitude : number - magnitude;
+    };
+
+    // First D of 5, -7, 9, -11, ... with (D / n) = -1. There is none when
+    // n is a square, which is checked once a few values have failed
+    int64_t d = 5;
+    for (int attempt = 0;; ++attempt)
+    {
+        const int symbol = jacobi(residue(d), number);
+        if (symbol == -1)
+        {
+            break;
+        }
+        if (symbol == 0 && static_cast<uint128>(d > 0 ? d : -d) != number)
+        {
+            return false;
+        }
+        if (attempt == 8)
+        {
+            const uint128 root = isqrt(number);
+            if (root * root == number)
+            {
+                return false;
+            }
+        }
+        d = d > 0 ? -(d + 2) : -d + 2;
+    }
+
+    // P = 1 and Q = (1 - D) / 4
+    const Montgomery montgomery(number);
+    const int64_t q = (1 - d) / 4;
+    const uint128 dMontgomery = montgomery.toMontgomery(residue(d));
+    const uint128 qMontgomery = montgomery.toMontgomery(residue(q));
+
+    // n + 1 = k * 2^s, k odd. n + 1 does not overflow, n being odd
+    uint128 k = number + 1;
+    int s = 0;
+    while (k % 2 == 0)
+    {
+        k /= 2;
+        ++s;
+    }
+
+    // U_k, V_k and Q^k by the binary method, from the highest bit of k
+    uint128 u = montgomery.one();
+    uint128 v = montgomery.one();
+    uint128 qk = qMontgomery;
+    int bit = 127;
+    while (((k >> bit) & 1) == 0)
+    {
+        --bit;
+    }
+    for (--bit; bit >= 0; --bit)
+    {
+        // Doubling: U_2j = U_j V_j, V_2j = V_j^2 - 2 Q^j
+        u = montgomery.multiply(u, v);
+        v = montgomery.subtract(montgomery.multiply(v, v), montgomery.add(qk, qk));
+        qk = montgomery.multiply(qk, qk);
+        if ((k >> bit) & 1)
+        {
+            // Increment: U_j+1 = (P U_j + V_j) / 2, V_j+1 = (D U_j + P V_j) / 2
+            const uint128 nextU = montgomery.half(montgomery.add(u, v));
+            v = montgomery.half(montgomery.add(montgomery.multiply(dMontgomery, u), v));
+            u = nextU;
+            qk = montgomery.multiply(qk, qMontgomery);
+        }
+    }
+
+    if (u == 0 || v == 0)
+    {
+        return true;
+    }
+    for (int r = 1; r < s; ++r)
+    {
+        v = montgomery.subtract(montgomery.multiply(v, v), montgomery.add(qk, qk));
+        if (v == 0)
+        {
+            return true;
+        }
+        qk = montgomery.multiply(qk, qk);
+    }
+    return false;
+}
+
+bool PrimeNumberDetector128::hasSmallDivisor(uint128 number)
+{
+    for (const PrimeGroup &group : primeGroups())
+    {
+        const uint64_t remainder = static_cast<uint64_t>(number % group.product);
+        for (size_t k = group.first; k < group.last; ++k)
+        {
+            if (remainder * smallPrimeInverses[k] <= smallPrimeLimits[k])
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int PrimeNumberDetector128::jacobi(uint128 a, uint128 n)
+{
+    int result = 1;
+    a %= n;
+    while (a != 0)
+    {
+        while (a % 2 == 0)
+        {
+            a /= 2;
+            const int r = static_cast<int>(n % 8);
+            if (r == 3 || r == 5)
+            {
+                result = -result;
+            }
+        }
+        std::swap(a, n);
+        if (a % 4 == 3 && n % 4 == 3)
+        {
+            result = -result;
+        }
+        a %= n;
+    }
+    return n == 1 ? result : 0;
+}
@@ -0,0 +1,75 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PRIMENUMBERDETECTOR128_H
+#define PRIMENUMBERDETECTOR128_H
+
+#include "primenumberdetector.h"
+#include "uint128.h"
+#include "workerpool.h"
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Prime number detector for 128-bit numbers
+ *
+ * Below 2^64, the numbers are tested by PrimeNumberDetectorMillerRabin.
+ * Above, trial division by the primes below 2^10 removes most of the
+ * composites, then the Baillie-PSW test runs a strong probable prime test
+ * in base 2 followed by a strong Lucas test. No composite passing both is
+ * known, but unlike the 64-bit case this is not proven.
+ *
+ * The modular products are computed in Montgomery form, on 256 bits. A
+ * single test takes at most about twenty microseconds, too little to gain
+ * from waking threads up, so the threads are only used by isPrimeBatch(),
+ * each one testing its own part of the numbers.
+ */
+class PrimeNumberDetector128 : public PrimeNumberDetectorInterface
+{
+public:
+    /**
+     * @brief Construct a detector
+     * @param nbThreads Number of threads testing the numbers of a batch
+     */
+    explicit PrimeNumberDetector128(size_t nbThreads = 1);
+
+    bool isPrime(uint64_t number) override;
+
+    /**
+     * @brief Check if a given 128-bit number is prime
+     */
+    bool isPrime(uint128 number);
+
+    using PrimeNumberDetectorInterface::isPrimeBatch;
+
+    /**
+     * @brief Check a batch of 128-bit numbers, the threads sharing the numbers
+     */
+    void isPrimeBatch(const uint128 *in, bool *out, size_t n);
+
+    /**
+     * @brief Strong probable prime test of an odd number for one base
+     * @param number The odd number to test, greater than 2
+     * @param base The base of the test
+     * @return false if the base proves the number composite, true otherwise
+     */
+    static bool isStrongProbablePrime(uint128 number, uint128 base);
+
+    /**
+     * @brief Strong Lucas probable prime test, with the parameters of
+     *        Selfridge's method A
+     * @param number The odd number to test, greater than 2
+     * @return false if the test proves the number composite, true otherwise
+     */
+    static bool isStrongLucasProbablePrime(uint128 number);
+
+private:
+    static bool hasSmallDivisor(uint128 number);
+    static int jacobi(uint128 a, uint128 n);
+
+    size_t nbThreads;
+    WorkerPool pool;
+    PrimeNumberDetectorMillerRabin detector64;
+};
+
+#endif // PRIMENUMBERDETECTOR128_H
@@ -0,0 +1,215 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "primenumberdetectort.h"
+
+#include "smallprimes.h"
+#include "uint128.h"
+
+#include <array>
+#include <limits>
+
+namespace
+{
+
+// One bit per odd number below 2^16, set for the primes: 4 KiB, where
+// smallComposites takes 64 KiB
+constexpr std::array<uint64_t, smallPrimesLimit / 128> makeOddPrimeBits()
+{
+    std::array<uint64_t, smallPrimesLimit / 128> bits{};
+    for (uint32_t n = 1; n < smallPrimesLimit; n += 2)
+    {
+        if (!smallComposites.composite[n])
+        {
+            bits[n / 128] |= uint64_t(1) << (n / 2 % 64);
+        }
+    }
+    return bits;
+}
+
+constexpr std::array<uint64_t, smallPrimesLimit / 128> oddPrimeBits = makeOddPrimeBits();
+
+// Odd primes tried before Miller-Rabin, which rejects 3 numbers out of 4
+// among the odd ones. smallPrimes[0] is 2
+constexpr size_t nbTrialPrimes = 15;
+static_assert(smallPrimes[nbTrialPrimes] == 53, "The trial primes go up to 53");
+
+/**
+ * @brief Arithmetic modulo an odd number in Montgomery form, on Word
+ *
+ * A value a is represented by a * 2^W mod n, W being the width of Word,
+ * so that a product needs multiplications of Wide, twice as wide, and no
+ * division.
+ */
+template<typename Word, typename Wide>
+class Montgomery
+{
+    static constexpr unsigned width = std::numeric_limits<Word>::digits;
+
+public:
+    explicit Montgomery(Word modulus)
+        : modulus(modulus), inverse(static_cast<Word>(inverse64(modulus)))
+    {
+        // 2^W - n and 2^W are equal modulo n
+        one = static_cast<Word>(Word(0) - modulus) % modulus;
+        rSquared = static_cast<Word>(static_cast<Wide>(one) * one % modulus);
+    }
+
+    Word toMontgomery(Word value) const
+    {
+        return multiply(value % modulus, rSquared);
+    }
+
+    // Product of two values in Montgomery form, in Montgomery form
+    Word multiply(Word a, Word b) const
+    {
+        const Wide product = static_cast<Wide>(a) * b;
+        const Word m = static_cast<Word>(product) * inverse;
+        const Word mnHigh = static_cast<Word>((static_cast<Wide>(m) * modulus) >> width);
+        const Word high = static_cast<Word>(product >> width);
+        // The low halves of product and m * n are equal
+        return high >= mnHigh ? high - mnHigh : high - mnHigh + modulus;
+    }
+
+    Word power(Word base, Word exponent) const
+    {
+        Word result = one;
+        while (exponent != 0)
+        {
+            if (exponent & 1)
+            {
+                result = multiply(result, base);
+            }
+            base = multiply(base, base);
+            exponent >>= 1;
+        }
+        return result;
+    }
+
+    // 1 in Montgomery form
+    Word one;
+
+private:
+    Word modulus;
+    Word inverse;
+    Word rSquared;
+};
+
+template<typename Word>
+bool hasTrialFactor(Word number)
+{
+    for (size_t k = 1; k <= nbTrialPrimes; ++k)
+    {
+        // Inverse modulo 2^W, the low bits of the inverse modulo 2^64
+        const Word inverse = static_cast<Word>(smallPrimeInverses[k]);
+        if (static_cast<Word>(number * inverse) <= std::numeric_limits<Word>::max() / smallPrimes[k])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Strong probable prime test of an odd number above 2^16 in every base
+template<typename Word, typename Wide, size_t N>
+bool isStrongProbablePrime(Word number, const std::array<uint32_t, N> &bases)
+{
+    const Montgomery<Word, Wide> arithmetic(number);
+    const Word minusOne = number - arithmetic.one;
+
+    Word d = number - 1;
+    unsigned s = 0;
+    while ((d & 1) == 0)
+    {
+        d >>= 1;
+        ++s;
+    }
+
+    for (uint32_t base : bases)
+    {
+        const Word a = arithmetic.toMontgomery(static_cast<Word>(base));
+        if (a == 0)
+        {
+            // A multiple of the number proves nothing
+            continue;
+        }
+        Word x = arithmetic.power(a, d);
+        if (x == arithmetic.one || x == minusOne)
+        {
+            continue;
+        }
+        unsigned r = 1;
+        for (; r < s; ++r)
+        {
+            x = arithmetic.multiply(x, x);
+            if (x == minusOne)
+            {
+                break;
+            }
+        }
+        if (r == s)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Enough for every number below 4759123141
+constexpr std::array<uint32_t, 3> bases32 = {2, 7, 61};
+// Enough for every 64-bit number, as in PrimeNumberDetectorMillerRabin
+constexpr std::array<uint32_t, 7> bases64 = {2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+} // namespace
+
+template<unsigned Width>
+bool PrimeNumberDetectorT<Width>::test(Number number)
+{
+    if constexpr (Width == 16)
+    {
+        if (number % 2 == 0)
+        {
+            return number == 2;
+        }
+        return (oddPrimeBits[number / 128] >> (number / 2 % 64)) & 1;
+    }
+    else
+    {
+        if (number < smallPrimesLimit)
+        {
+            return PrimeNumberDetectorT<16>::test(static_cast<uint16_t>(number));
+        }
+        if (number % 2 == 0 || hasTrialFactor(number))
+        {
+            return false;
+        }
+        if constexpr (Width == 32)
+        {
+            return isStrongProbablePrime<uint32_t, uint64_t>(number, bases32);
+        }
+        else
+        {
+            return isStrongProbablePrime<uint64_t, uint128>(number, bases64);
+        }
+    }
+}
+
+template<unsigned Width>
+bool PrimeNumberDetectorT<Width>::isPrime(uint64_t number)
+{
+    if (number < smallPrimesLimit)
+    {
+        return PrimeNumberDetectorT<16>::test(static_cast<uint16_t>(number));
+    }
+    if constexpr (Width >= 32)
+    {
+        if (number <= std::numeric_limits<uint32_t>::max())
+        {
+            return PrimeNumberDetectorT<32>::test(static_cast<uint32_t>(number));
+        }
+    }
+    return PrimeNumberDetectorT<64>::test(number);
+}
+
+template class PrimeNumberDetectorT<16>;
+template class PrimeNumberDetectorT<32>;
+template class PrimeNumberDetectorT<64>;
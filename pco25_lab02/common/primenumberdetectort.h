@@ -0,0 +1,48 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PRIMENUMBERDETECTORT_H
+#define PRIMENUMBERDETECTORT_H
+
+#include "primenumberdetector.h"
+
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @brief Prime number detector specialized for a width of numbers
+ *
+ * test() is the kernel of one width, chosen at compile time:
+ * - 16 bits: a bit per odd number in a table computed at compile time
+ * - 32 bits: trial division by a few primes, then Miller-Rabin in bases 2,
+ *   7 and 61, with 32-bit Montgomery products
+ * - 64 bits: the same with the 7 bases of PrimeNumberDetectorMillerRabin,
+ *   with 64-bit Montgomery products instead of 128-bit divisions
+ *
+ * isPrime() calls the narrowest kernel able to hold the number, among the
+ * kernels up to Width. A number wider than Width is still tested, by the
+ * 64-bit kernel. The answers are exact, 2 included.
+ *
+ * The kernels are instantiated in primenumberdetectort.cpp for the three
+ * widths, so that the tables stay out of this header.
+ */
+template<unsigned Width>
+class PrimeNumberDetectorT : public PrimeNumberDetectorInterface
+{
+    static_assert(Width == 16 || Width == 32 || Width == 64, "Width must be 16, 32 or 64");
+
+public:
+    using Number = std::conditional_t<Width == 16, uint16_t, std::conditional_t<Width == 32, uint32_t, uint64_t>>;
+
+    /**
+     * @brief Check if a number of this width is prime, without dispatching
+     */
+    static bool test(Number number);
+
+    bool isPrime(uint64_t number) override;
+};
+
+extern template class PrimeNumberDetectorT<16>;
+extern template class PrimeNumberDetectorT<32>;
+extern template class PrimeNumberDetectorT<64>;
+
+#endif // PRIMENUMBERDETECTORT_H
@@ -0,0 +1,212 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "primenumberindex.h"
+#include "segmentedsieve.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char PrimeNumberDetectorIndex::magic[8] = {'P', 'R', 'I', 'M', 'E', 'I', 'D', 'X'};
+
+namespace
+{
+
+std::runtime_error systemError(const std::string &message, const std::string &path)
+{
+    return std::runtime_error(message + " " + path + ": " + std::strerror(errno));
+}
+
+// Counts the bits [from, to) of the bitmap, read 8 bytes at a time in
+// little-endian order, as in SegmentedSieve. It is inlined in each of the
+// versions below, so that popcount is compiled to a single instruction
+// when the processor has it
+inline __attribute__((always_inline)) uint64_t countBits(const uint8_t *bits, uint64_t from, uint64_t to)
+{
+    uint64_t count = 0;
+    for (uint64_t word = from / 64; word * 64 < to; ++word)
+    {
+        uint64_t value;
+        std::memcpy(&value, bits + word * 8, sizeof(value));
+        if (word * 64 < from)
+        {
+            value &= ~uint64_t{0} << (from % 64);
+        }
+        if ((word + 1) * 64 > to)
+        {
+            value &= ~uint64_t{0} >> (64 - (to - word * 64));
+        }
+        count += __builtin_popcountll(value);
+    }
+    return count;
+}
+
+__attribute__((target("popcnt")))
+uint64_t countBitsPopcnt(const uint8_t *bits, uint64_t from, uint64_t to)
+{
+    return countBits(bits, from, to);
+}
+
+uint64_t countBitsGeneric(const uint8_t *bits, uint64_t from, uint64_t to)
+{
+    return countBits(bits, from, to);
+}
+
+} // namespace
+
+// In the bitmap, bit i stands for the odd number 2 * i + 1
+
+size_t PrimeNumberDetectorIndex::bitmapBytes(uint64_t limit)
+{
+    return static_cast<size_t>((limit / 2 + 63) / 64 * 8);
+}
+
+uint64_t PrimeNumberDetectorIndex::build(const std::string &path, uint64_t limit, size_t nbThreads)
+{
+    // The index is written next to its final place, then renamed, so that
+    // a reader never maps an incomplete file
+    const std::string temporaryPath = path + ".tmp";
+    const int fd = open(temporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw systemError("Cannot create", temporaryPath);
+    }
+    const size_t fileLength = sizeof(Header) + bitmapBytes(limit);
+    if (ftruncate(fd, static_cast<off_t>(fileLength)) != 0)
+    {
+        close(fd);
+        unlink(temporaryPath.c_str());
+        throw systemError("Cannot resize", temporaryPath);
+    }
+    void *address = mmap(nullptr, fileLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        unlink(temporaryPath.c_str());
+        throw systemError("Cannot map", temporaryPath);
+    }
+
+    // The file is created filled with zeros, the sieve only sets the bits
+    // of the primes
+    uint8_t *data = static_cast<uint8_t *>(address);
+    SegmentedSieve sieve(nbThreads);
+    const uint64_t nbPrimes = sieve.oddBitmap(limit, data + sizeof(Header));
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.limit = limit;
+    header.nbPrimes = nbPrimes;
+    std::memcpy(data, &header, sizeof(header));
+
+    const bool synced = msync(address, fileLength, MS_SYNC) == 0;
+    munmap(address, fileLength);
+    if (!synced || std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+    {
+        unlink(temporaryPath.c_str());
+        throw systemError("Cannot write", path);
+    }
+    return nbPrimes;
+}
+
+PrimeNumberDetectorIndex::PrimeNumberDetectorIndex(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw systemError("Cannot open", path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        throw systemError("Cannot read the size of", path);
+    }
+    length = static_cast<size_t>(status.st_size);
+    if (length < sizeof(Header))
+    {
+        close(fd);
+        throw std::runtime_error(path + " is not a prime index");
+    }
+    mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        throw systemError("Cannot map", path);
+    }
+
+    Header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version
+        || length != sizeof(Header) + bitmapBytes(header.limit))
+    {
+        munmap(mapping, length);
+        throw std::runtime_error(path + " is not a prime index");
+    }
+    indexLimit = header.limit;
+    bits = static_cast<const uint8_t *>(mapping) + sizeof(Header);
+    // Lookups are scattered, reading ahead would load unused pages
+    madvise(mapping, length, MADV_RANDOM);
+}
+
+PrimeNumberDetectorIndex::~PrimeNumberDetectorIndex()
+{
+    munmap(mapping, length);
+}
+
+bool PrimeNumberDetectorIndex::isPrime(uint64_t number)
+{
+    if (number >= indexLimit)
+    {
+        return fallback.isPrime(number);
+    }
+    if (number % 2 == 0)
+    {
+        return number == 2;
+    }
+    const uint64_t bit = number / 2;
+    return (bits[bit / 8] >> (bit % 8)) & 1;
+}
+
+uint64_t PrimeNumberDetectorIndex::countPrimes(uint64_t lower, uint64_t upper)
+{
+    if (upper <= lower)
+    {
+        return 0;
+    }
+
+    uint64_t count = 0;
+    if (upper > indexLimit)
+    {
+        SegmentedSieve sieve(1);
+        count += sieve.countPrimes(std::max(lower, indexLimit), upper);
+        upper = indexLimit;
+    }
+    if (lower >= upper)
+    {
+        return count;
+    }
+    if (lower <= 2 && upper > 2)
+    {
+        ++count;
+    }
+
+    // Odd numbers of the range, as bit indices
+    const uint64_t from = lower / 2;
+    const uint64_t to = upper / 2;
+    static const bool hasPopcnt = __builtin_cpu_supports("popcnt");
+    count += hasPopcnt ? countBitsPopcnt(bits, from, to) : countBitsGeneric(bits, from, to);
+    return count;
+}
+
+uint64_t PrimeNumberDetectorIndex::limit() const
+{
+    return indexLimit;
+}
@@ -0,0 +1,88 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PRIMENUMBERINDEX_H
+#define PRIMENUMBERINDEX_H
+
+#include "primenumberdetector.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Detector reading the primes from a precomputed file
+ *
+ * The file, written by build(), holds one bit per odd number below a
+ * limit, set if the number is prime, as computed by SegmentedSieve. It is
+ * memory-mapped, so that isPrime() is a single memory access below the
+ * limit, and countPrimes() counts the bits of the range with popcount
+ * instead of sieving it again. The pages are shared by all the processes
+ * using the same file, and only the parts actually read are loaded.
+ *
+ * Beyond the limit, the numbers are tested with Miller-Rabin, and the
+ * ranges are sieved. The file takes limit / 16 bytes, so 625 MB for 1e10.
+ */
+class PrimeNumberDetectorIndex : public PrimeNumberDetectorInterface
+{
+public:
+    /**
+     * @brief Write the index of the primes below limit
+     * @param path The file to write. It is replaced only once complete
+     * @param limit End of the indexed range, excluded
+     * @param nbThreads Number of threads sieving the range
+     * @return The number of primes below limit
+     * @throws std::runtime_error if the file cannot be written
+     */
+    static uint64_t build(const std::string &path, uint64_t limit, size_t nbThreads);
+
+    /**
+     * @brief Map an index written by build()
+     * @throws std::runtime_error if the file cannot be mapped or is not an
+     *         index
+     */
+    explicit PrimeNumberDetectorIndex(const std::string &path);
+
+    ~PrimeNumberDetectorIndex() override;
+
+    PrimeNumberDetectorIndex(const PrimeNumberDetectorIndex &) = delete;
+    PrimeNumberDetectorIndex &operator=(const PrimeNumberDetectorIndex &) = delete;
+
+    bool isPrime(uint64_t number) override;
+
+    /**
+     * @brief Count the primes in [lower, upper)
+     *
+     * The part of the range beyond the limit of the index is sieved.
+     */
+    uint64_t countPrimes(uint64_t lower, uint64_t upper);
+
+    /**
+     * @brief End of the indexed range, excluded
+     */
+    uint64_t limit() const;
+
+private:
+    // Fields in the byte order of the machine, followed by the bitmap
+    struct Header
+    {
+        char magic[8];
+        uint64_t version;
+        uint64_t limit;
+        uint64_t nbPrimes;
+        uint64_t reserved[4];
+    };
+
+    static const char magic[8];
+    static const uint64_t version = 1;
+
+    // Size of the bitmap, rounded up to whole 64-bit words
+    static size_t bitmapBytes(uint64_t limit);
+
+    void *mapping = nullptr;
+    size_t length = 0;
+    const uint8_t *bits = nullptr;
+    uint64_t indexLimit = 0;
+    PrimeNumberDetectorMillerRabin fallback;
+};
+
+#endif // PRIMENUMBERINDEX_H
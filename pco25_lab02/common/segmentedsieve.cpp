@@ -0,0 +1,299 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "segmentedsieve.h"
+#include "uint128.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <unistd.h>
+
+const uint64_t SegmentedSieve::presievePrimes[] = {3, 5, 7, 11, 13};
+
+namespace
+{
+
+size_t cacheSize(int name, size_t fallback)
+{
+    const long size = sysconf(name);
+    return size > 0 ? static_cast<size_t>(size) : fallback;
+}
+
+} // namespace
+
+// In the sieve, bit i stands for the odd number 2 * i + 1
+
+SegmentedSieve::SegmentedSieve(size_t nbThreads, size_t segmentBytes)
+    : nbThreads(nbThreads == 0 ? 1 : nbThreads), segmentBytes(segmentBytes), pool(nbThreads),
+      pattern(patternBytes, 0xFF)
+{
+    for (uint64_t p : presievePrimes)
+    {
+        for (uint64_t i = p / 2; i < patternBytes * 8; i += p)
+        {
+            pattern[i / 8] &= static_cast<uint8_t>(~(1u << (i % 8)));
+        }
+    }
+}
+
+uint64_t SegmentedSieve::countPrimes(uint64_t lower, uint64_t upper)
+{
+    uint64_t count = 0;
+    sieve(lower, upper, count, nullptr);
+    return count;
+}
+
+std::vector<uint64_t> SegmentedSieve::primes(uint64_t lower, uint64_t upper)
+{
+    uint64_t count = 0;
+    std::vector<std::vector<uint64_t>> primeLists;
+    sieve(lower, upper, count, &primeLists);
+
+    std::vector<uint64_t> result;
+    result.reserve(count);
+    for (const std::vector<uint64_t> &list : primeLists)
+    {
+        result.insert(result.end(), list.begin(), list.end());
+    }
+    return result;
+}
+
+uint64_t SegmentedSieve::countRough(uint64_t lower, uint64_t upper, uint64_t maxFactor)
+{
+    uint64_t count = 0;
+    sieve(lower, upper, count, nullptr, nullptr, maxFactor);
+    return count;
+}
+
+uint64_t SegmentedSieve::oddBitmap(uint64_t upper, uint8_t *bitmap)
+{
+    uint64_t count = 0;
+    sieve(0, upper, count, nullptr, bitmap);
+    return count;
+}
+
+std::vector<uint32_t> SegmentedSieve::sievingPrimes(uint64_t limit)
+{
+    // Odd-only sieve, one byte per odd number, by segments of 32 KiB: near
+    // 2^64 the sieving primes go up to 2^32 and a whole sieve would not
+    // stay in cache. The primes up to sqrt(limit) come from a simple sieve
+    const uint64_t root = isqrt(limit);
+    std::vector<bool> rootComposite(root / 2 + 1, false);
+    std::vector<uint64_t> rootPrimes;
+    std::vector<uint64_t> next;
+    for (uint64_t p = 3; p <= root; p += 2)
+    {
+        if (!rootComposite[p / 2])
+        {
+            rootPrimes.push_back(p);
+            next.push_back(p * p / 2);
+            for (uint64_t m = p * p; m <= root; m += 2 * p)
+            {
+                rootComposite[m / 2] = true;
+            }
+        }
+    }
+
+    const uint64_t segmentSize = 32 * 1024;
+    const uint64_t end = limit / 2 + 1;
+    std::vector<uint8_t> composite(segmentSize);
+    std::vector<uint32_t> result;
+    // pi(x) < 1.26 x / ln(x)
+    result.reserve(static_cast<size_t>(1.26 * limit / std::log(std::max<double>(limit, 3))) + 16);
+    for (uint64_t low = 0; low < end; low += segmentSize)
+    {
+        const uint64_t high = std::min(low + segmentSize, end);
+        std::fill(composite.begin(), composite.end(), 0);
+        for (size_t k = 0; k < rootPrimes.size(); ++k)
+        {
+            uint64_t i = next[k];
+            for (; i < high; i += rootPrimes[k])
+            {
+                composite[i - low] = 1;
+            }
+            next[k] = i;
+        }
+        // Index 0 stands for 1, and the presieved primes are left out
+        for (uint64_t i = std::max<uint64_t>(low, presievePrimes[std::size(presievePrimes) - 1] / 2 + 1); i < high; ++i)
+        {
+            if (!composite[i - low])
+            {
+                result.push_back(static_cast<uint32_t>(2 * i + 1));
+            }
+        }
+    }
+    return result;
+}
+
+void SegmentedSieve::sieve(uint64_t lower, uint64_t upper, uint64_t &count, std::vector<std::vector<uint64_t>> *primeLists,
+                           uint8_t *bitmap, uint64_t maxFactor)
+{
+    count = 0;
+    if (upper <= lower)
+    {
+        return;
+    }
+    if (lower <= 2 && upper > 2)
+    {
+        count = 1;
+    }
+
+    // Odd numbers of the range, as bit indices
+    const uint64_t first = lower / 2;
+    const uint64_t last = upper / 2;
+    const std::vector<uint32_t> primes = sievingPrimes(std::min(isqrt(upper - 1), maxFactor));
+
+    size_t bytes = segmentBytes;
+    if (bytes == 0)
+    {
+        bytes = cacheSize(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+        if (!primes.empty() && primes.back() > bytes * 16)
+        {
+            // The sieving primes and their next multiples share the L2 cache
+            bytes = cacheSize(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024) / 4;
+        }
+    }
+    bytes = std::max<size_t>((bytes + 7) / 8 * 8, 8);
+    const uint64_t segmentBits = bytes * 8;
+
+    // Segments are aligned on multiples of segmentBits, so that the pattern
+    // can be copied byte by byte
+    const uint64_t firstSegment = first / segmentBits;
+    const uint64_t nbSegments = (last + segmentBits - 1) / segmentBits - firstSegment;
+    const size_t nbTasks = static_cast<size_t>(std::min<uint64_t>(nbSegments, nbThreads * 8));
+
+    std::vector<uint64_t> counts(nbTasks, 0);
+    std::vector<std::vector<uint64_t>> lists(primeLists ? nbTasks : 0);
+
+    pool.run(nbTasks, [&](size_t task)
+    {
+        // Each task sieves a contiguous block of segments, so the next
+        // multiple of every sieving prime is carried from one segment to
+        // the next one. A prime only starts sieving in the segment of its
+        // square, so the primes in use are a prefix of primes, and the
+        // offset of their next multiple in the segment is below p
+        const uint64_t taskFirst = firstSegment + nbSegments * task / nbTasks;
+        const uint64_t taskLast = firstSegment + nbSegments * (task + 1) / nbTasks;
+        std::vector<uint8_t> bits(bytes);
+        std::vector<uint32_t> offsets;
+        offsets.reserve(primes.size());
+
+        for (uint64_t segment = taskFirst; segment < taskLast; ++segment)
+        {
+            const uint64_t segmentStart = segment * segmentBits;
+            const uint64_t segmentEnd = segmentStart + segmentBits;
+
+            for (size_t k = offsets.size(); k < primes.size(); ++k)
+            {
+                const uint64_t p = primes[k];
+                // First odd multiple of p, at least p * p, from the segment,
+                // as a bit index: the odd multiples of p are at p / 2 + j * p.
+                // The multiple itself may not fit 64 bits near 2^64
+                const uint64_t square = p * p / 2;
+                if (square >= segmentEnd)
+                {
+                    break;
+                }
+                const uint64_t next = segmentStart <= square ? square : p / 2 + (segmentStart - p / 2 + p - 1) / p * p;
+                offsets.push_back(static_cast<uint32_t>(next - segmentStart));
+            }
+
+            size_t offset = static_cast<size_t>((segmentStart / 8) % patternBytes);
+            for (size_t copied = 0; copied < bytes;)
+            {
+                const size_t length = std::min(bytes - copied, patternBytes - offset);
+                std::memcpy(bits.data() + copied, pattern.data() + offset, length);
+                copied += length;
+                offset = 0;
+            }
+            if (segmentStart == 0)
+            {
+                // 1 is not prime, the presieved primes are
+                bits[0] &= static_cast<uint8_t>(~1u);
+                for (uint64_t p : presievePrimes)
+                {
+                    if (p / 2 < segmentBits)
+                    {
+                        bits[p / 2 / 8] |= static_cast<uint8_t>(1u << (p / 2 % 8));
+                    }
+                }
+            }
+
+            for (size_t k = 0; k < offsets.size(); ++k)
+            {
+                const uint64_t p = primes[k];
+                uint64_t bit = offsets[k];
+                for (; bit < segmentBits; bit += p)
+                {
+                    bits[bit / 8] &= static_cast<uint8_t>(~(1u << (bit % 8)));
+                }
+                offsets[k] = static_cast<uint32_t>(bit - segmentBits);
+            }
+
+            // Only the part of the segment inside the range is read
+            const uint64_t from = std::max(first, segmentStart) - segmentStart;
+            const uint64_t to = std::min(last, segmentEnd) - segmentStart;
+            if (bitmap)
+            {
+                // The segments are aligned on bytes, so the threads never
+                // write the same byte
+                const size_t toBytes = static_cast<size_t>((to + 7) / 8);
+                std::memcpy(bitmap + segmentStart / 8, bits.data(), toBytes);
+                if (to % 8 != 0)
+                {
+                    bitmap[segmentStart / 8 + toBytes - 1] &= static_cast<uint8_t>((1u << (to % 8)) - 1);
+                }
+            }
+            if (primeLists)
+            {
+                for (uint64_t bit = from; bit < to; ++bit)
+                {
+                    if (bits[bit / 8] & (1u << (bit % 8)))
+                    {
+                        lists[task].push_back(2 * (segmentStart + bit) + 1);
+                    }
+                }
+                continue;
+            }
+            // The bytes are read 8 at a time, in little-endian order
+            uint64_t taskCount = 0;
+            for (uint64_t word = from / 64; word * 64 < to; ++word)
+            {
+                uint64_t value;
+                std::memcpy(&value, bits.data() + word * 8, sizeof(value));
+                if (word * 64 < from)
+                {
+                    value &= ~uint64_t{0} << (from % 64);
+                }
+                if ((word + 1) * 64 > to)
+                {
+                    value &= ~uint64_t{0} >> (64 - (to - word * 64));
+                }
+                taskCount += __builtin_popcountll(value);
+            }
+            counts[task] += taskCount;
+        }
+        if (primeLists)
+        {
+            counts[task] = lists[task].size();
+        }
+    });
+
+    for (uint64_t taskCount : counts)
+    {
+        count += taskCount;
+    }
+    if (primeLists)
+    {
+        primeLists->clear();
+        if (lower <= 2 && upper > 2)
+        {
+            primeLists->push_back({2});
+        }
+        for (std::vector<uint64_t> &list : lists)
+        {
+            primeLists->push_back(std::move(list));
+        }
+    }
+}
@@ -0,0 +1,89 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef SEGMENTEDSIEVE_H
+#define SEGMENTEDSIEVE_H
+
+#include "workerpool.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Segmented sieve of Eratosthenes for the primes of a range
+ *
+ * Only the odd numbers are stored, one bit each. The range is sieved by
+ * segments sized to the data cache, so that the crossing off of the
+ * multiples stays in cache. Each segment starts from a precomputed pattern
+ * where the multiples of 3, 5, 7, 11 and 13 are already crossed off, which
+ * removes the densest part of the work.
+ *
+ * The segments are shared among the threads of a WorkerPool. The sieving
+ * primes, up to the square root of the end of the range, are kept in
+ * memory, with the offset of their next multiple for each running thread:
+ * any range of 64-bit numbers can be sieved, but near 2^64 this takes
+ * 800 MB for the primes and as much per thread.
+ */
+class SegmentedSieve
+{
+public:
+    /**
+     * @brief Construct a sieve
+     * @param nbThreads Number of threads sieving the segments
+     * @param segmentBytes Size of a segment in bytes, 0 to use the size of
+     *        the L1 data cache, or of a quarter of the L2 cache when the
+     *        sieving primes are larger than an L1 sized segment
+     */
+    explicit SegmentedSieve(size_t nbThreads, size_t segmentBytes = 0);
+
+    /**
+     * @brief Count the primes in [lower, upper)
+     */
+    uint64_t countPrimes(uint64_t lower, uint64_t upper);
+
+    /**
+     * @brief List the primes in [lower, upper), in increasing order
+     */
+    std::vector<uint64_t> primes(uint64_t lower, uint64_t upper);
+
+    /**
+     * @brief Count the numbers of [lower, upper) that are 2, or odd, above 1
+     *        and without a prime factor up to maxFactor but themselves
+     *
+     * Only the primes up to maxFactor, and 3 to 13 in any case, are sieved
+     * with, so that the end of the 64-bit range can be sieved cheaply. With
+     * maxFactor at least sqrt(upper - 1), this counts the primes.
+     */
+    uint64_t countRough(uint64_t lower, uint64_t upper, uint64_t maxFactor);
+
+    /**
+     * @brief Write the bitmap of the odd primes below upper
+     * @param upper End of the range, excluded
+     * @param bitmap Where the bitmap is written, (upper / 2 + 7) / 8 bytes.
+     *        Bit i of byte j, that stands for 2 * (8 * j + i) + 1, is set
+     *        if this number is prime
+     * @return The number of primes below upper, 2 included
+     */
+    uint64_t oddBitmap(uint64_t upper, uint8_t *bitmap);
+
+private:
+    static const uint64_t presievePrimes[];
+    // The pattern repeats every 3 * 5 * 7 * 11 * 13 odd numbers, that is
+    // every 15015 bytes
+    static const size_t patternBytes = 15015;
+
+    // Sieves [lower, upper) and counts, or lists in primeLists, the primes.
+    // When bitmap is given, lower has to be 0 and the bits of the odd
+    // numbers are copied there as well. The sieving primes stop at maxFactor
+    void sieve(uint64_t lower, uint64_t upper, uint64_t &count, std::vector<std::vector<uint64_t>> *primeLists,
+               uint8_t *bitmap = nullptr, uint64_t maxFactor = UINT64_MAX);
+
+    static std::vector<uint32_t> sievingPrimes(uint64_t limit);
+
+    size_t nbThreads;
+    size_t segmentBytes;
+    WorkerPool pool;
+    std::vector<uint8_t> pattern;
+};
+
+#endif // SEGMENTEDSIEVE_H
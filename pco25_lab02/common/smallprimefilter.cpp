@@ -0,0 +1,179 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "smallprimefilter.h"
+#include "smallprimes.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define SMALLPRIMEFILTER_X86
+#endif
+
+namespace
+{
+
+// The odd primes tested by the filter start at index 1 of the tables
+constexpr const uint16_t *primes = smallPrimes.data() + 1;
+constexpr const uint64_t *inverses = smallPrimeInverses.data() + 1;
+constexpr const uint64_t *limits = smallPrimeLimits.data() + 1;
+
+static_assert(primes[SmallPrimeFilter::nbPrimes - 1] == 131, "The filter tests the odd primes up to 131");
+
+size_t filterScalar(const uint64_t *in, bool *candidate, size_t n)
+{
+    size_t nbCandidates = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        candidate[i] = SmallPrimeFilter::isCandidate(in[i]);
+        nbCandidates += candidate[i];
+    }
+    return nbCandidates;
+}
+
+#ifdef SMALLPRIMEFILTER_X86
+
+// GCC 12 reports the _mm*_undefined_* values used inside the intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+// The low 64 bits of a * b, from three 32-bit multiplications. This is
+// faster than the AVX-512DQ vpmullq, which is microcoded on most processors,
+// and the high half of b is the same for the whole batch
+__attribute__((target("avx512f")))
+inline __m512i mulLo64(__m512i a, __m512i b, __m512i bHigh)
+{
+    const __m512i low = _mm512_mul_epu32(a, b);
+    const __m512i cross = _mm512_add_epi64(_mm512_mul_epu32(_mm512_srli_epi64(a, 32), b),
+                                           _mm512_mul_epu32(a, bHigh));
+    return _mm512_add_epi64(low, _mm512_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx512f")))
+size_t filterAvx512(const uint64_t *in, bool *candidate, size_t n)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i two = _mm512_set1_epi64(2);
+    size_t nbCandidates = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m512i numbers = _mm512_loadu_si512(in + i);
+        // Numbers below 2, and even numbers other than 2
+        __mmask8 composite = _mm512_cmplt_epu64_mask(numbers, two);
+        composite |= _mm512_testn_epi64_mask(numbers, one) & _mm512_cmpneq_epu64_mask(numbers, two);
+        for (size_t k = 0; k < SmallPrimeFilter::nbPrimes; ++k)
+        {
+            const __m512i product = mulLo64(numbers, _mm512_set1_epi64(inverses[k]),
+                                            _mm512_set1_epi64(inverses[k] >> 32));
+            composite |= _mm512_cmple_epu64_mask(product, _mm512_set1_epi64(limits[k]))
+                       & _mm512_cmpneq_epu64_mask(numbers, _mm512_set1_epi64(primes[k]));
+            if (composite == 0xFF)
+            {
+                break;
+            }
+        }
+        for (size_t lane = 0; lane < 8; ++lane)
+        {
+            candidate[i + lane] = !((composite >> lane) & 1);
+        }
+        nbCandidates += 8 - __builtin_popcount(composite);
+    }
+    return nbCandidates + filterScalar(in + i, candidate + i, n - i);
+}
+
+// AVX2 has neither 64-bit multiplication nor unsigned comparison
+__attribute__((target("avx2")))
+inline __m256i mulLo64(__m256i a, __m256i b, __m256i bHigh)
+{
+    const __m256i low = _mm256_mul_epu32(a, b);
+    const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                           _mm256_mul_epu32(a, bHigh));
+    return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+
+__attribute__((target("avx2")))
+size_t filterAvx2(const uint64_t *in, bool *candidate, size_t n)
+{
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i two = _mm256_set1_epi64x(2);
+    const __m256i twoSigned = _mm256_xor_si256(two, sign);
+    size_t nbCandidates = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256i numbers = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        const __m256i numbersSigned = _mm256_xor_si256(numbers, sign);
+        // Numbers below 2, and even numbers other than 2
+        __m256i composite = _mm256_cmpgt_epi64(twoSigned, numbersSigned);
+        composite = _mm256_or_si256(composite,
+                                    _mm256_andnot_si256(_mm256_cmpeq_epi64(numbers, two),
+                                                        _mm256_cmpeq_epi64(_mm256_and_si256(numbers, one), _mm256_setzero_si256())));
+        for (size_t k = 0; k < SmallPrimeFilter::nbPrimes; ++k)
+        {
+            const __m256i product = mulLo64(numbers, _mm256_set1_epi64x(inverses[k]),
+                                            _mm256_set1_epi64x(inverses[k] >> 32));
+            const __m256i limit = _mm256_set1_epi64x(limits[k] ^ INT64_MIN);
+            const __m256i divisible = _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_xor_si256(product, sign), limit),
+                                                          _mm256_set1_epi64x(-1));
+            const __m256i isPrime = _mm256_cmpeq_epi64(numbers, _mm256_set1_epi64x(primes[k]));
+            composite = _mm256_or_si256(composite, _mm256_andnot_si256(isPrime, divisible));
+            if (_mm256_movemask_pd(_mm256_castsi256_pd(composite)) == 0xF)
+            {
+                break;
+            }
+        }
+        const int mask = _mm256_movemask_pd(_mm256_castsi256_pd(composite));
+        for (size_t lane = 0; lane < 4; ++lane)
+        {
+            candidate[i + lane] = !((mask >> lane) & 1);
+        }
+        nbCandidates += 4 - __builtin_popcount(mask);
+    }
+    return nbCandidates + filterScalar(in + i, candidate + i, n - i);
+}
+
+#pragma GCC diagnostic pop
+
+#endif // SMALLPRIMEFILTER_X86
+
+using FilterFunction = size_t (*)(const uint64_t *, bool *, size_t);
+
+FilterFunction selectFilter()
+{
+#ifdef SMALLPRIMEFILTER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return filterAvx512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return filterAvx2;
+    }
+#endif
+    return filterScalar;
+}
+
+} // namespace
+
+size_t SmallPrimeFilter::filter(const uint64_t *in, bool *candidate, size_t n)
+{
+    static const FilterFunction function = selectFilter();
+    return function(in, candidate, n);
+}
+
+bool SmallPrimeFilter::isCandidate(uint64_t number)
+{
+    if (number < 2 || (number % 2 == 0 && number != 2))
+    {
+        return false;
+    }
+    for (size_t k = 0; k < nbPrimes; ++k)
+    {
+        if (number * inverses[k] <= limits[k] && number != primes[k])
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef SMALLPRIMEFILTER_H
+#define SMALLPRIMEFILTER_H
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Eliminates the numbers of a batch having a small prime factor
+ *
+ * A number n is divisible by an odd prime p if and only if
+ * n * inverse(p) mod 2^64 <= (2^64 - 1) / p, where inverse(p) is the
+ * inverse of p modulo 2^64. This replaces each division by a
+ * multiplication and a comparison, which are vectorized over the numbers of
+ * the batch with AVX-512F or AVX2 when the processor supports them.
+ */
+class SmallPrimeFilter
+{
+public:
+    /**
+     * @brief Mark the numbers that may be prime
+     * @param in The numbers to filter
+     * @param candidate Set to false for the numbers that are not prime
+     *        (less than 2 or having a small prime factor other than
+     *        themselves), and to true for the others
+     * @param n Number of numbers in the batch
+     * @return Number of numbers that may be prime
+     */
+    static size_t filter(const uint64_t *in, bool *candidate, size_t n);
+
+    /**
+     * @brief Check a single number, with the same rules as filter()
+     */
+    static bool isCandidate(uint64_t number);
+
+    // Odd primes tested by the filter, from 3 to 131
+    static const size_t nbPrimes = 31;
+};
+
+#endif // SMALLPRIMEFILTER_H
@@ -0,0 +1,175 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef SMALLPRIMES_H
+#define SMALLPRIMES_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Tables computed at compile time for the trial division kernels
+ *
+ * smallPrimes holds every prime below 2^16, which are all the divisors
+ * needed to test a 32-bit number, along with their inverses modulo 2^64
+ * to test divisibility without dividing. Beyond the table, the candidate
+ * divisors are the numbers coprime to 2 * 3 * 5 * 7 = 210: the wheel skips
+ * 77% of the integers, where testing odd numbers only skips 50%.
+ */
+
+inline constexpr uint32_t smallPrimesLimit = 1 << 16;
+
+// A plain array rather than a std::array, which is several times slower to
+// evaluate at compile time
+struct CompositeTable
+{
+    bool composite[smallPrimesLimit];
+};
+
+constexpr CompositeTable makeCompositeTable()
+{
+    CompositeTable table{};
+    table.composite[0] = table.composite[1] = true;
+    for (uint32_t p = 2; p * p < smallPrimesLimit; ++p)
+    {
+        if (!table.composite[p])
+        {
+            for (uint32_t m = p * p; m < smallPrimesLimit; m += p)
+            {
+                table.composite[m] = true;
+            }
+        }
+    }
+    return table;
+}
+
+inline constexpr CompositeTable smallComposites = makeCompositeTable();
+
+constexpr size_t countSmallPrimes()
+{
+    size_t count = 0;
+    for (uint32_t i = 0; i < smallPrimesLimit; ++i)
+    {
+        count += !smallComposites.composite[i];
+    }
+    return count;
+}
+
+inline constexpr size_t nbSmallPrimes = countSmallPrimes();
+
+constexpr std::array<uint16_t, nbSmallPrimes> makeSmallPrimes()
+{
+    std::array<uint16_t, nbSmallPrimes> primes{};
+    size_t count = 0;
+    for (uint32_t i = 0; i < smallPrimesLimit; ++i)
+    {
+        if (!smallComposites.composite[i])
+        {
+            primes[count++] = static_cast<uint16_t>(i);
+        }
+    }
+    return primes;
+}
+
+inline constexpr std::array<uint16_t, nbSmallPrimes> smallPrimes = makeSmallPrimes();
+
+// Inverse of an odd number modulo 2^64, by Newton's iteration: each step
+// doubles the number of correct low bits, and 3 * d ^ 2 is correct on 5 bits
+constexpr uint64_t inverse64(uint64_t d)
+{
+    uint64_t inverse = (3 * d) ^ 2;
+    for (int i = 0; i < 4; ++i)
+    {
+        inverse *= 2 - d * inverse;
+    }
+    return inverse;
+}
+
+// For an odd prime p, n is a multiple of p if and only if
+// n * smallPrimeInverses[k] <= smallPrimeLimits[k] (modulo 2^64).
+// The entries for 2 are not meaningful
+constexpr std::array<uint64_t, nbSmallPrimes> makeSmallPrimeInverses()
+{
+    std::array<uint64_t, nbSmallPrimes> inverses{};
+    for (size_t k = 1; k < nbSmallPrimes; ++k)
+    {
+        inverses[k] = inverse64(smallPrimes[k]);
+    }
+    return inverses;
+}
+
+constexpr std::array<uint64_t, nbSmallPrimes> makeSmallPrimeLimits()
+{
+    std::array<uint64_t, nbSmallPrimes> limits{};
+    for (size_t k = 1; k < nbSmallPrimes; ++k)
+    {
+        limits[k] = UINT64_MAX / smallPrimes[k];
+    }
+    return limits;
+}
+
+inline constexpr std::array<uint64_t, nbSmallPrimes> smallPrimeInverses = makeSmallPrimeInverses();
+inline constexpr std::array<uint64_t, nbSmallPrimes> smallPrimeLimits = makeSmallPrimeLimits();
+
+inline constexpr uint32_t wheelModulus = 2 * 3 * 5 * 7;
+inline constexpr size_t wheelSize = 48;
+
+constexpr bool isWheelResidue(uint32_t r)
+{
+    return r % 2 != 0 && r % 3 != 0 && r % 5 != 0 && r % 7 != 0;
+}
+
+// The residues modulo 210 that are coprime to 210, in increasing order
+constexpr std::array<uint8_t, wheelSize> makeWheelResidues()
+{
+    std::array<uint8_t, wheelSize> residues{};
+    size_t count = 0;
+    for (uint32_t r = 0; r < wheelModulus; ++r)
+    {
+        if (isWheelResidue(r))
+        {
+            residues[count++] = static_cast<uint8_t>(r);
+        }
+    }
+    return residues;
+}
+
+inline constexpr std::array<uint8_t, wheelSize> wheelResidues = makeWheelResidues();
+
+// wheelGaps[k] is the distance from the residue k to the next one
+constexpr std::array<uint8_t, wheelSize> makeWheelGaps()
+{
+    std::array<uint8_t, wheelSize> gaps{};
+    for (size_t k = 0; k < wheelSize; ++k)
+    {
+        const uint32_t next = k + 1 < wheelSize ? wheelResidues[k + 1] : wheelResidues[0] + wheelModulus;
+        gaps[k] = static_cast<uint8_t>(next - wheelResidues[k]);
+    }
+    return gaps;
+}
+
+inline constexpr std::array<uint8_t, wheelSize> wheelGaps = makeWheelGaps();
+
+// wheelNext[r] is the index of the first residue >= r, wheelSize if none
+constexpr std::array<uint8_t, wheelModulus> makeWheelNext()
+{
+    std::array<uint8_t, wheelModulus> next{};
+    size_t k = 0;
+    for (uint32_t r = 0; r < wheelModulus; ++r)
+    {
+        while (k < wheelSize && wheelResidues[k] < r)
+        {
+            ++k;
+        }
+        next[r] = static_cast<uint8_t>(k);
+    }
+    return next;
+}
+
+inline constexpr std::array<uint8_t, wheelModulus> wheelNext = makeWheelNext();
+
+static_assert(nbSmallPrimes == 6542, "There are 6542 primes below 2^16");
+static_assert(smallPrimes[nbSmallPrimes - 1] * smallPrimeInverses[nbSmallPrimes - 1] == 1, "Wrong inverse");
+static_assert(wheelResidues[0] == 1 && wheelResidues[wheelSize - 1] == 209, "Wrong wheel residues");
+
+#endif // SMALLPRIMES_H
@@ -0,0 +1,245 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "threadplacement.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+
+// Parses a list of CPUs as written by the kernel, such as "0-3,8,10-11"
+std::vector<int> parseCpuList(const std::string &text)
+{
+    std::vector<int> cpus;
+    std::stringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        const size_t dash = range.find('-');
+        try
+        {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (const std::logic_error &)
+        {
+            // Empty or malformed part, such as the trailing new line
+        }
+    }
+    return cpus;
+}
+
+bool readFile(const std::filesystem::path &path, std::string &content)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    std::getline(file, content);
+    return true;
+}
+
+int readInt(const std::filesystem::path &path, int fallback)
+{
+    std::string content;
+    if (!readFile(path, content))
+    {
+        return fallback;
+    }
+    try
+    {
+        return std::stoi(content);
+    }
+    catch (const std::logic_error &)
+    {
+        return fallback;
+    }
+}
+
+std::vector<int> allowedCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+} // namespace
+
+const CpuTopology &CpuTopology::machine()
+{
+    static const CpuTopology topology("/sys/devices/system", allowedCpus());
+    return topology;
+}
+
+CpuTopology::CpuTopology(const std::string &root, const std::vector<int> &allowed)
+{
+    const std::filesystem::path system(root);
+    std::string online;
+    std::vector<int> ids = readFile(system / "cpu" / "online", online) ? parseCpuList(online) : allowed;
+    if (!allowed.empty())
+    {
+        const std::set<int> allowedSet(allowed.begin(), allowed.end());
+        ids.erase(std::remove_if(ids.begin(), ids.end(), [&](int id) { return allowedSet.count(id) == 0; }), ids.end());
+    }
+
+    std::map<int, int> nodeOf;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(system / "node", error))
+    {
+        const std::string name = entry.path().filename().string();
+        std::string list;
+        if (name.rfind("node", 0) == 0 && name.size() > 4 && std::isdigit(static_cast<unsigned char>(name[4]))
+            && readFile(entry.path() / "cpulist", list))
+        {
+            for (int cpu : parseCpuList(list))
+            {
+                nodeOf[cpu] = std::stoi(name.substr(4));
+            }
+        }
+    }
+
+    for (int id : ids)
+    {
+        const std::filesystem::path topology = system / "cpu" / ("cpu" + std::to_string(id)) / "topology";
+        const auto node = nodeOf.find(id);
+        // Without core_id, the CPU is its own core, below any real one
+        const int ownCore = std::numeric_limits<int>::min() + id;
+        cpuList.push_back({id, readInt(topology / "physical_package_id", 0), readInt(topology / "core_id", ownCore),
+                           node == nodeOf.end() ? 0 : node->second});
+    }
+
+    // Compact: the siblings of a core are adjacent, the cores of a node too
+    std::vector<Cpu> sorted = cpuList;
+    std::sort(sorted.begin(), sorted.end(), [](const Cpu &a, const Cpu &b)
+    {
+        return std::tie(a.node, a.package, a.core, a.id) < std::tie(b.node, b.package, b.core, b.id);
+    });
+    for (const Cpu &cpu : sorted)
+    {
+        compactOrder.push_back(cpu.id);
+    }
+
+    // Scatter: ranked by sibling number first, then by the position of the
+    // core within its node, then by node
+    struct Rank
+    {
+        int sibling;
+        int coreInNode;
+        int node;
+        int id;
+    };
+    std::vector<Rank> ranks;
+    std::map<std::tuple<int, int, int>, std::pair<int, int>> cores;
+    std::map<int, int> nbCoresInNode;
+    for (const Cpu &cpu : sorted)
+    {
+        const auto core = cores.try_emplace(std::make_tuple(cpu.node, cpu.package, cpu.core), nbCoresInNode[cpu.node], 0);
+        if (core.second)
+        {
+            ++nbCoresInNode[cpu.node];
+        }
+        // First is the position of the core in its node, second the number
+        // of its siblings already ranked
+        std::pair<int, int> &position = core.first->second;
+        ranks.push_back({position.second++, position.first, cpu.node, cpu.id});
+    }
+    coreCount = cores.size();
+    std::sort(ranks.begin(), ranks.end(), [](const Rank &a, const Rank &b)
+    {
+        return std::tie(a.sibling, a.coreInNode, a.node, a.id) < std::tie(b.sibling, b.coreInNode, b.node, b.id);
+    });
+    for (const Rank &rank : ranks)
+    {
+        scatterOrder.push_back(rank.id);
+    }
+
+    std::map<int, std::vector<int>> byNode;
+    for (const Cpu &cpu : sorted)
+    {
+        byNode[cpu.node].push_back(cpu.id);
+    }
+    for (auto &node : byNode)
+    {
+        nodeCpus.push_back(std::move(node.second));
+    }
+}
+
+const std::vector<CpuTopology::Cpu> &CpuTopology::cpus() const
+{
+    return cpuList;
+}
+
+size_t CpuTopology::nbCores() const
+{
+    return coreCount;
+}
+
+size_t CpuTopology::nbNodes() const
+{
+    return nodeCpus.size();
+}
+
+std::vector<int> CpuTopology::cpusFor(ThreadPlacement placement, size_t index) const
+{
+    if (cpuList.empty())
+    {
+        return {};
+    }
+    switch (placement)
+    {
+    case ThreadPlacement::Compact:
+        return {compactOrder[index % compactOrder.size()]};
+    case ThreadPlacement::Scatter:
+        return {scatterOrder[index % scatterOrder.size()]};
+    case ThreadPlacement::NumaNode:
+        return nodeCpus[index % nodeCpus.size()];
+    case ThreadPlacement::None:
+        break;
+    }
+    return {};
+}
+
+bool pinCurrentThread(const std::vector<int> &cpus)
+{
+    if (cpus.empty())
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
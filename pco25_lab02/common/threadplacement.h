@@ -0,0 +1,86 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef THREADPLACEMENT_H
+#define THREADPLACEMENT_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Where the threads of a WorkerPool run
+ */
+enum class ThreadPlacement
+{
+    // Left to the operating system
+    None,
+    // Packed on as few physical cores as possible: all the SMT siblings of
+    // a core, then the next core of the same NUMA node
+    Compact,
+    // One thread per physical core, alternating between the NUMA nodes,
+    // before the second SMT sibling of any core is used
+    Scatter,
+    // Thread i may run on any CPU of the i-th NUMA node, modulo the number
+    // of nodes
+    NumaNode
+};
+
+/**
+ * @brief Logical CPUs of the machine, with their physical core and NUMA node
+ *
+ * The topology is read from sysfs. A missing file makes the CPU a core of
+ * its own on node 0, so the placements degrade to one CPU per thread.
+ */
+class CpuTopology
+{
+public:
+    struct Cpu
+    {
+        int id;
+        int package;
+        int core;
+        int node;
+    };
+
+    /**
+     * @brief Topology of this machine, restricted to the CPUs the process
+     *        is allowed to use when it is first called
+     */
+    static const CpuTopology &machine();
+
+    /**
+     * @brief Read a topology
+     * @param root The sysfs directory holding cpu/ and node/, normally
+     *        /sys/devices/system
+     * @param allowed The CPUs to keep, all of them if empty
+     */
+    explicit CpuTopology(const std::string &root, const std::vector<int> &allowed = {});
+
+    const std::vector<Cpu> &cpus() const;
+
+    size_t nbCores() const;
+
+    size_t nbNodes() const;
+
+    /**
+     * @brief CPUs on which the thread of a given index may run
+     * @return The allowed CPUs, empty for ThreadPlacement::None or if no
+     *         CPU is known
+     */
+    std::vector<int> cpusFor(ThreadPlacement placement, size_t index) const;
+
+private:
+    std::vector<Cpu> cpuList;
+    std::vector<int> compactOrder;
+    std::vector<int> scatterOrder;
+    std::vector<std::vector<int>> nodeCpus;
+    size_t coreCount = 0;
+};
+
+/**
+ * @brief Restrict the calling thread to some CPUs
+ * @return false if the list is empty or the system refused it
+ */
+bool pinCurrentThread(const std::vector<int> &cpus);
+
+#endif // THREADPLACEMENT_H
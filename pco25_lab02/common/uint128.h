@@ -0,0 +1,64 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef UINT128_H
+#define UINT128_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Helpers for the 128-bit integers of GCC and Clang
+ *
+ * The square roots are exact: a double only has 53 bits of mantissa, so
+ * std::sqrt can be off by one above 2^53, and missing the divisor of the
+ * square of a prime is enough to report it as prime.
+ */
+
+using uint128 = unsigned __int128;
+
+/**
+ * @brief Largest integer whose square is at most n
+ */
+inline uint64_t isqrt(uint64_t n)
+{
+    // The estimate is within one of the root, but may reach 2^32, whose
+    // square does not fit on 64 bits
+    uint64_t root = std::min<uint64_t>(static_cast<uint64_t>(std::sqrt(static_cast<double>(n))), 0xFFFFFFFF);
+    while (root * root > n)
+    {
+        --root;
+    }
+    while (root < 0xFFFFFFFF && (root + 1) * (root + 1) <= n)
+    {
+        ++root;
+    }
+    return root;
+}
+
+/**
+ * @brief Largest integer whose square is at most n
+ */
+inline uint64_t isqrt(uint128 n)
+{
+    if ((n >> 64) == 0)
+    {
+        return isqrt(static_cast<uint64_t>(n));
+    }
+    // Newton's iteration decreases towards the root from any starting point
+    // above it. The estimate of the double is exact to 2^-52 relatively
+    const double estimate = std::sqrt(static_cast<double>(n));
+    uint128 root = static_cast<uint128>(estimate) + static_cast<uint128>(estimate / (uint64_t{1} << 50)) + 2;
+    root = std::min<uint128>(root, UINT64_MAX);
+    while (true)
+    {
+        const uint128 next = (root + n / root) / 2;
+        if (next >= root)
+        {
+            return static_cast<uint64_t>(root);
+        }
+        root = next;
+    }
+}
+
+#endif // UINT128_H
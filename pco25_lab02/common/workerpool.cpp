@@ -0,0 +1,99 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "workerpool.h"
+
+WorkerPool::WorkerPool(size_t nbThreads, ThreadPlacement placement)
+    : nbThreads(nbThreads == 0 ? 1 : nbThreads)
+{
+    workers.reserve(this->nbThreads - 1);
+    for (size_t i = 1; i < this->nbThreads; ++i)
+    {
+        workers.push_back(std::make_unique<PcoThread>(&WorkerPool::workerLoop, this,
+                                                      CpuTopology::machine().cpusFor(placement, i)));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    mutex.lock();
+    stopping = true;
+    workAvailable.notifyAll();
+    mutex.unlock();
+
+    for (std::unique_ptr<PcoThread> &worker : workers)
+    {
+        worker->join();
+    }
+}
+
+size_t WorkerPool::size() const
+{
+    return nbThreads;
+}
+
+void WorkerPool::run(size_t nbTasks, const std::function<void(size_t)> &task)
+{
+    if (nbTasks == 0)
+    {
+        return;
+    }
+
+    runMutex.lock();
+    mutex.lock();
+    currentTask = &task;
+    this->nbTasks = nbTasks;
+    nextTask = 0;
+    nbDone = 0;
+    workAvailable.notifyAll();
+
+    // The caller executes tasks as well, instead of just waiting
+    while (nextTask < this->nbTasks)
+    {
+        const size_t index = nextTask++;
+        mutex.unlock();
+        task(index);
+        mutex.lock();
+        ++nbDone;
+    }
+    while (nbDone < this->nbTasks)
+    {
+        jobDone.wait(&mutex);
+    }
+
+    currentTask = nullptr;
+    this->nbTasks = 0;
+    nextTask = 0;
+    mutex.unlock();
+    runMutex.unlock();
+}
+
+void WorkerPool::workerLoop(std::vector<int> cpus)
+{
+    // A refused placement is not an error, the thread runs anywhere
+    pinCurrentThread(cpus);
+
+    mutex.lock();
+    while (true)
+    {
+        while (!stopping && nextTask >= nbTasks)
+        {
+            workAvailable.wait(&mutex);
+        }
+        if (stopping)
+        {
+            break;
+        }
+
+        const size_t index = nextTask++;
+        const std::function<void(size_t)> *task = currentTask;
+        mutex.unlock();
+        (*task)(index);
+        mutex.lock();
+
+        if (++nbDone == nbTasks)
+        {
+            jobDone.notifyOne();
+        }
+    }
+    mutex.unlock();
+}
@@ -0,0 +1,78 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include "threadplacement.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <pcosynchro/pcothread.h>
+#include <pcosynchro/pcomutex.h>
+#include <pcosynchro/pcoconditionvariable.h>
+
+/**
+ * @brief Pool of long-lived threads executing batches of indexed tasks
+ *
+ * The threads are created once, in the constructor, and wait for work
+ * between two calls to run(). The calling thread takes part in the
+ * execution, so a pool of nbThreads uses nbThreads - 1 PcoThread.
+ *
+ * With a placement other than ThreadPlacement::None, each thread restricts
+ * itself to the CPUs of its index when it starts. The index 0 stands for
+ * the calling thread, which is left where it is: it can pin itself with
+ * pinCurrentThread(CpuTopology::machine().cpusFor(placement, 0)).
+ */
+class WorkerPool
+{
+public:
+    /**
+     * @brief Construct the pool and start its threads
+     * @param nbThreads Number of threads executing the tasks, caller included
+     * @param placement Where the threads run
+     */
+    explicit WorkerPool(size_t nbThreads, ThreadPlacement placement = ThreadPlacement::None);
+
+    /**
+     * @brief Stop and join the threads of the pool
+     */
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    /**
+     * @brief Number of threads executing the tasks, caller included
+     */
+    size_t size() const;
+
+    /**
+     * @brief Execute task(0) ... task(nbTasks - 1) and wait for all of them
+     * @param nbTasks Number of tasks
+     * @param task Function called with the index of each task
+     *
+     * Concurrent calls are executed one after the other.
+     */
+    void run(size_t nbTasks, const std::function<void(size_t)> &task);
+
+private:
+    void workerLoop(std::vector<int> cpus);
+
+    size_t nbThreads;
+    std::vector<std::unique_ptr<PcoThread>> workers;
+
+    PcoMutex runMutex;
+    PcoMutex mutex;
+    PcoConditionVariable workAvailable{false};
+    PcoConditionVariable jobDone;
+
+    const std::function<void(size_t)> *currentTask = nullptr;
+    size_t nbTasks = 0;
+    size_t nextTask = 0;
+    size_t nbDone = 0;
+    bool stopping = false;
+};
+
+#endif // WORKERPOOL_H
@@ -1,6 +1,27 @@
 #include <benchmark/benchmark.h>
 
+#include "factorizer.h"
+#include "primecounter.h"
+#include "primenumberasync.h"
+#include "primenumbercache.h"
 #include "primenumberdetector.h"
+#include "primenumberdetector128.h"
+#include "primenumberdetectort.h"
+#include "primenumberindex.h"
+#include "segmentedsieve.h"
+#include "smallprimes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <x86intrin.h>
 
 static void BM_SingleThread(benchmark::State& state) {
     PrimeNumberDetector pnd;
@@ -24,4 +45,525 @@ static void BM_MultiThread(benchmark::State& state) {
 BENCHMARK(BM_MultiThread)->ArgsProduct({{1, 2, 4, 8}, {433494437, 433494436}})->Unit(benchmark::kMicrosecond)->UseRealTime();
 BENCHMARK(BM_MultiThread)->ArgsProduct({{1, 2, 4, 8}, {99194853094755497, 99194853094755499}})->Unit(benchmark::kMillisecond)->UseRealTime();
 
+static void BM_Budgeted(benchmark::State& state) {
+    PrimeNumberDetectorMultiThread pndm(1);
+    const std::chrono::microseconds budget(state.range(1));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pndm.isPrimeWithin(state.range(0), std::chrono::steady_clock::now() + budget));
+    }
+    // Mean time per call of each stage, over the calls that reached it
+    const char *names[] = {"small_primes_ns", "probable_prime_ns", "deterministic_ns"};
+    for (size_t stage = 0; stage < PrimeNumberDetectorMultiThread::nbStages; ++stage) {
+        const auto metrics = pndm.stageMetrics(static_cast<PrimeNumberDetectorMultiThread::Stage>(stage));
+        state.counters[names[stage]] = metrics.first == 0 ? 0.0 : double(metrics.second.count()) / metrics.first;
+    }
+}
+
+// Arguments are number to test and budget in microseconds, to compare with
+// BM_MultiThread. isPrimeWithin() runs on the calling thread only
+BENCHMARK(BM_Budgeted)->ArgsProduct({{99194853094755497, 99194853094755499}, {0, 1, 10, 100}})->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_Wheel(benchmark::State& state) {
+    PrimeNumberDetectorWheel pnd;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pnd.isPrime(state.range(0)));
+    }
+}
+
+// Argument is the number to test, to compare with BM_SingleThread
+BENCHMARK(BM_Wheel)->Arg(433494437)->Arg(433494436)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_Wheel)->Arg(99194853094755497)->Arg(99194853094755499)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Inverse(benchmark::State& state) {
+    PrimeNumberDetectorInverse pnd;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pnd.isPrime(state.range(0)));
+    }
+}
+
+// Argument is the number to test, to compare with BM_SingleThread and BM_Wheel
+BENCHMARK(BM_Inverse)->Arg(433494437)->Arg(433494436)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_Inverse)->Arg(99194853094755497)->Arg(99194853094755499)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Number of divisors tested by the odd and by the wheel kernels for a prime
+static uint64_t nbCandidates(uint64_t number, bool wheel) {
+    const uint64_t maxDivisor = static_cast<uint64_t>(std::sqrt(number));
+    if (!wheel) {
+        return maxDivisor < 3 ? 0 : (maxDivisor - 1) / 2;
+    }
+    uint64_t count = 0;
+    for (size_t k = 1; k < nbSmallPrimes && smallPrimes[k] <= maxDivisor; ++k) {
+        ++count;
+    }
+    for (uint64_t divisor = smallPrimes.back() + 1; divisor <= maxDivisor; ++divisor) {
+        count += isWheelResidue(divisor % wheelModulus);
+    }
+    return count;
+}
+
+static void BM_CyclesPerCandidate(benchmark::State& state) {
+    std::unique_ptr<PrimeNumberDetectorInterface> pnd;
+    switch (state.range(0)) {
+    case 0: pnd = std::make_unique<PrimeNumberDetector>(); break;
+    case 1: pnd = std::make_unique<PrimeNumberDetectorWheel>(); break;
+    default: pnd = std::make_unique<PrimeNumberDetectorInverse>(); break;
+    }
+    const uint64_t number = state.range(1);
+    uint64_t cycles = 0;
+    for (auto _ : state) {
+        const uint64_t start = __rdtsc();
+        benchmark::DoNotOptimize(pnd->isPrime(number));
+        cycles += __rdtsc() - start;
+    }
+    // Time stamp counter cycles, which tick at the nominal frequency
+    state.counters["cycles_per_candidate"] = static_cast<double>(cycles) / state.iterations() / nbCandidates(number, state.range(0) != 0);
+}
+
+// Arguments are the kernel (0: odd divisors, 1: wheel, 2: wheel without
+// division) and a prime to test, within and beyond the small prime table
+BENCHMARK(BM_CyclesPerCandidate)->ArgsProduct({{0, 1, 2}, {433494437, 1000000000039, 99194853094755497}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_MultiThreadWheel(benchmark::State& state) {
+    PrimeNumberDetectorMultiThread pndm(state.range(0), PrimeNumberDetectorMultiThread::Scheduling::Static,
+                                        PrimeNumberDetectorMultiThread::Kernel::Wheel);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pndm.isPrime(state.range(1)));
+    }
+}
+
+// Arguments are number of threads and numbers to test, to compare with BM_MultiThread
+BENCHMARK(BM_MultiThreadWheel)->ArgsProduct({{1, 2, 4, 8}, {433494437, 433494436}})->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_MultiThreadWheel)->ArgsProduct({{1, 2, 4, 8}, {99194853094755497, 99194853094755499}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Placement(benchmark::State& state) {
+    static const char* const names[] = {"none", "compact", "scatter", "numa-node"};
+    const ThreadPlacement placement = static_cast<ThreadPlacement>(state.range(1));
+    PrimeNumberDetectorMultiThread pndm(state.range(0), PrimeNumberDetectorMultiThread::Scheduling::Static,
+                                        PrimeNumberDetectorMultiThread::Kernel::Odd, placement);
+    // The calling thread takes part in the work, so it is placed as well,
+    // then allowed on every CPU again
+    const bool pinned = pinCurrentThread(CpuTopology::machine().cpusFor(placement, 0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pndm.isPrime(state.range(2)));
+    }
+    if (pinned) {
+        std::vector<int> allCpus;
+        for (const CpuTopology::Cpu& cpu : CpuTopology::machine().cpus()) {
+            allCpus.push_back(cpu.id);
+        }
+        pinCurrentThread(allCpus);
+    }
+    state.SetLabel(names[state.range(1)]);
+}
+
+// Arguments are the number of threads, the placement (none, compact,
+// scatter, numa-node) and the number to test
+BENCHMARK(BM_Placement)->ArgsProduct({{2, 4, 8}, {0, 1, 2, 3}, {99194853094755497}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_CancellationLatency(benchmark::State& state) {
+    PrimeNumberDetectorMultiThread pndm(state.range(0));
+    // 1000003 * 9999999967: the divisor is found by the first thread at the
+    // start of its range, while the others are still testing theirs
+    const uint64_t number = 1000003ULL * 9999999967ULL;
+    double latency = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pndm.isPrime(number));
+        latency += std::chrono::duration<double, std::micro>(pndm.lastCancellationLatency()).count();
+    }
+    // Time from the discovery of the divisor to the return of isPrime()
+    state.counters["cancel_us"] = benchmark::Counter(latency, benchmark::Counter::kAvgIterations);
+}
+
+// Argument is the number of threads
+BENCHMARK(BM_CancellationLatency)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Threads spinning during a benchmark, to simulate a busy machine
+class BackgroundLoad {
+public:
+    explicit BackgroundLoad(size_t nbThreads) {
+        for (size_t i = 0; i < nbThreads; ++i) {
+            threads.emplace_back([this] {
+                while (!stop.load(std::memory_order_relaxed)) {
+                }
+            });
+        }
+    }
+
+    ~BackgroundLoad() {
+        stop = true;
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+};
+
+static void BM_Scheduling(benchmark::State& state) {
+    const auto scheduling = state.range(1) == 0 ? PrimeNumberDetectorMultiThread::Scheduling::Static
+                                                : PrimeNumberDetectorMultiThread::Scheduling::Dynamic;
+    PrimeNumberDetectorMultiThread pndm(state.range(0), scheduling);
+    BackgroundLoad load(state.range(3));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pndm.isPrime(state.range(2)));
+    }
+}
+
+// Arguments are the number of threads, the scheduling (0: static, 1: dynamic),
+// the number to test and the number of threads loading the machine.
+// The numbers are a composite with a small divisor, a composite whose two
+// divisors are close to its square root, and a prime
+BENCHMARK(BM_Scheduling)->ArgsProduct({{4}, {0, 1}, {1000003LL * 9999999967LL, 10000019LL * 10000079LL, 100000000000031LL}, {0, 2}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static PrimeNumberDetectorMillerRabin cachedDetector;
+static std::unique_ptr<PrimeNumberDetectorCache> cache;
+
+static void BM_Cache(benchmark::State& state) {
+    const int hitPercent = state.range(0);
+    const size_t hotSize = 1 << 14;
+    if (state.thread_index() == 0) {
+        cache = std::make_unique<PrimeNumberDetectorCache>(cachedDetector, 1 << 20);
+        for (uint64_t i = 0; i < hotSize; ++i) {
+            cache->isPrime((i << 20) | 1);
+        }
+    }
+    // The calls are taken either from the numbers already in the cache, or
+    // from numbers never seen before, which are different for each thread
+    std::mt19937_64 generator(state.thread_index());
+    uint64_t fresh = (static_cast<uint64_t>(state.thread_index()) + 1) << 48;
+    for (auto _ : state) {
+        uint64_t number;
+        if (static_cast<int>(generator() % 100) < hitPercent) {
+            number = ((generator() % hotSize) << 20) | 1;
+        }
+        else {
+            fresh += 2;
+            number = fresh | 1;
+        }
+        benchmark::DoNotOptimize(cache->isPrime(number));
+    }
+    if (state.thread_index() == 0) {
+        // The misses of the warm-up are not counted
+        state.counters["hit_rate"] = static_cast<double>(cache->hits()) / (cache->hits() + cache->misses() - hotSize);
+    }
+}
+
+// Argument is the percentage of calls on numbers in the cache, run with
+// several threads sharing the cache. The detector behind is Miller-Rabin
+BENCHMARK(BM_Cache)->Arg(0)->Arg(50)->Arg(90)->Arg(99)->Threads(1)->Threads(2)->Threads(4)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_NoCache(benchmark::State& state) {
+    uint64_t number = uint64_t{1} << 48;
+    for (auto _ : state) {
+        number += 2;
+        benchmark::DoNotOptimize(cachedDetector.isPrime(number | 1));
+    }
+}
+
+// The same fresh numbers without cache, the cost of a miss without the cache
+BENCHMARK(BM_NoCache)->Threads(1)->Threads(4)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static std::unique_ptr<PrimeNumberDetectorInterface> clientsDetector;
+
+static void BM_ConcurrentClients(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        if (state.range(0) == 0) {
+            clientsDetector = std::make_unique<PrimeNumberDetectorMultiThread>(4, PrimeNumberDetectorMultiThread::Scheduling::Dynamic,
+                                                                               PrimeNumberDetectorMultiThread::Kernel::Wheel);
+        }
+        else {
+            clientsDetector = std::make_unique<PrimeNumberDetectorAsync>(4);
+        }
+    }
+    // Odd numbers of about 40 bits, large enough for isPrime() to use all
+    // the threads of PrimeNumberDetectorMultiThread
+    std::mt19937_64 generator(state.thread_index());
+    std::uniform_int_distribution<uint64_t> distribution(uint64_t{1} << 39, uint64_t{1} << 40);
+    std::vector<uint64_t> numbers(64);
+    for (uint64_t& number : numbers) {
+        number = distribution(generator) | 1;
+    }
+    for (auto _ : state) {
+        for (uint64_t number : numbers) {
+            benchmark::DoNotOptimize(clientsDetector->isPrime(number));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+    if (state.thread_index() == 0) {
+        if (auto async = dynamic_cast<PrimeNumberDetectorAsync*>(clientsDetector.get())) {
+            // Average size of the batches, all clients together
+            state.counters["per_batch"] = static_cast<double>(state.iterations() * numbers.size() * state.threads())
+                                          / async->nbBatches();
+        }
+        clientsDetector.reset();
+    }
+}
+
+// Argument is 0 for PrimeNumberDetectorMultiThread called directly by the
+// clients, 1 for PrimeNumberDetectorAsync, both with 4 threads. The
+// benchmark threads are the clients, each one testing numbers one by one
+BENCHMARK(BM_ConcurrentClients)->Arg(0)->Arg(1)->Threads(1)->Threads(4)->Threads(16)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_Factorize(benchmark::State& state) {
+    Factorizer factorizer(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(factorizer.factorize(state.range(1)).data());
+    }
+}
+
+// Arguments are the number of threads and the number to factorize: products
+// of two primes of 20 and 34 bits, of 24 bits and of 31 bits, and a 57-bit prime
+BENCHMARK(BM_Factorize)->ArgsProduct({{1, 4}, {1000003LL * 9999999967LL, 10000019LL * 10000079LL,
+                                                2147483647LL * 2147483629LL, 99194853094755497LL}})->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_MillerRabin(benchmark::State& state) {
+    PrimeNumberDetectorMillerRabin pnd;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(pnd.isPrime(state.range(0)));
+    }
+}
+
+// Argument is the number to test, same numbers as for the other detectors
+BENCHMARK(BM_MillerRabin)->Arg(433494437)->Arg(433494436)->Arg(99194853094755497)->Arg(99194853094755499)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Random odd numbers of a given width, tested by PrimeNumberDetectorMillerRabin
+// or by PrimeNumberDetectorT<64>, which dispatches them to the kernel of
+// their width, or by the kernel of their width directly
+static void BM_FixedWidth(benchmark::State& state) {
+    const int width = state.range(0);
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<uint64_t> distribution(uint64_t(1) << (width - 1),
+                                                         width == 64 ? UINT64_MAX : (uint64_t(1) << width) - 1);
+    std::vector<uint64_t> numbers(4096);
+    for (uint64_t& number : numbers) {
+        number = distribution(generator) | 1;
+    }
+
+    PrimeNumberDetectorMillerRabin millerRabin;
+    PrimeNumberDetectorT<64> dispatched;
+    for (auto _ : state) {
+        for (uint64_t number : numbers) {
+            switch (state.range(1)) {
+            case 0:
+                benchmark::DoNotOptimize(millerRabin.isPrime(number));
+                break;
+            case 1:
+                benchmark::DoNotOptimize(dispatched.isPrime(number));
+                break;
+            default:
+                if (width == 16) {
+                    benchmark::DoNotOptimize(PrimeNumberDetectorT<16>::test(number));
+                }
+                else if (width == 32) {
+                    benchmark::DoNotOptimize(PrimeNumberDetectorT<32>::test(number));
+                }
+                else {
+                    benchmark::DoNotOptimize(PrimeNumberDetectorT<64>::test(number));
+                }
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+
+// Arguments are the width of the numbers and the detector: 0 for
+// PrimeNumberDetectorMillerRabin, 1 for PrimeNumberDetectorT<64>::isPrime,
+// 2 for PrimeNumberDetectorT<width>::test
+BENCHMARK(BM_FixedWidth)->ArgsProduct({{16, 32, 64}, {0, 1, 2}})->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Random odd numbers below 2^32, the same for every batch benchmark
+static std::vector<uint64_t> batchNumbers(size_t n) {
+    std::mt19937_64 generator(42);
+    std::vector<uint64_t> numbers(n);
+    for (uint64_t &number : numbers) {
+        number = (generator() >> 32) | 1;
+    }
+    return numbers;
+}
+
+static std::unique_ptr<PrimeNumberDetectorInterface> batchDetector(int64_t kind) {
+    switch (kind) {
+    case 0: return std::make_unique<PrimeNumberDetector>();
+    case 1: return std::make_unique<PrimeNumberDetectorMultiThread>(4);
+    default: return std::make_unique<PrimeNumberDetectorMillerRabin>();
+    }
+}
+
+static void BM_OneByOne(benchmark::State& state) {
+    auto pnd = batchDetector(state.range(0));
+    const std::vector<uint64_t> numbers = batchNumbers(state.range(1));
+    for (auto _ : state) {
+        for (uint64_t number : numbers) {
+            benchmark::DoNotOptimize(pnd->isPrime(number));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+
+static void BM_Batch(benchmark::State& state) {
+    auto pnd = batchDetector(state.range(0));
+    const std::vector<uint64_t> numbers = batchNumbers(state.range(1));
+    std::unique_ptr<bool[]> results(new bool[numbers.size()]);
+    for (auto _ : state) {
+        pnd->isPrimeBatch(numbers.data(), results.get(), numbers.size());
+        benchmark::DoNotOptimize(results.get());
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+
+static void BM_SmallPrimeFilter(benchmark::State& state) {
+    const std::vector<uint64_t> numbers = batchNumbers(state.range(0));
+    std::unique_ptr<bool[]> candidates(new bool[numbers.size()]);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SmallPrimeFilter::filter(numbers.data(), candidates.get(), numbers.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+
+// Arguments are the detector (0: single thread, 1: 4 threads, 2: Miller-Rabin)
+// and the size of the batch. Throughput is reported in items (numbers) per second
+BENCHMARK(BM_OneByOne)->ArgsProduct({{0, 1, 2}, {4096}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_Batch)->ArgsProduct({{0, 1, 2}, {4096}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SmallPrimeFilter)->Arg(4096)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Odd numbers of exactly the given width, primes only when primes is true
+static std::vector<uint128> numbers128(int64_t bits, bool primes, size_t n) {
+    PrimeNumberDetector128 detector;
+    std::mt19937_64 generator(bits);
+    std::vector<uint128> numbers;
+    while (numbers.size() < n) {
+        uint128 number = (static_cast<uint128>(generator()) << 64) | generator();
+        number = (number >> (128 - bits)) | (static_cast<uint128>(1) << (bits - 1)) | 1;
+        if (!primes || detector.isPrime(number)) {
+            numbers.push_back(number);
+        }
+    }
+    return numbers;
+}
+
+static void BM_Prime128(benchmark::State& state) {
+    PrimeNumberDetector128 detector;
+    const std::vector<uint128> numbers = numbers128(state.range(0), state.range(1), 256);
+    for (auto _ : state) {
+        for (uint128 number : numbers) {
+            benchmark::DoNotOptimize(detector.isPrime(number));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+
+static void BM_Prime128Batch(benchmark::State& state) {
+    PrimeNumberDetector128 detector(state.range(2));
+    const std::vector<uint128> numbers = numbers128(state.range(0), state.range(1), 4096);
+    std::unique_ptr<bool[]> results(new bool[numbers.size()]);
+    for (auto _ : state) {
+        detector.isPrimeBatch(numbers.data(), results.get(), numbers.size());
+        benchmark::DoNotOptimize(results.get());
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+
+// Arguments are the width of the numbers in bits, whether they are all
+// primes (1) or random odd numbers (0), and for the batch the number of
+// threads
+BENCHMARK(BM_Prime128)->ArgsProduct({{64, 80, 96, 128}, {0, 1}})->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_Prime128Batch)->ArgsProduct({{80, 96, 128}, {0, 1}, {1, 4}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Start of the sieved range: 0 for 0, 10^k otherwise
+static uint64_t sieveStart(int64_t exponent) {
+    uint64_t start = exponent > 0 ? 1 : 0;
+    for (int64_t i = 0; i < exponent; ++i) {
+        start *= 10;
+    }
+    return start;
+}
+
+static void BM_SieveCount(benchmark::State& state) {
+    SegmentedSieve sieve(state.range(0));
+    const uint64_t start = sieveStart(state.range(1));
+    const uint64_t length = state.range(2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sieve.countPrimes(start, start + length));
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+}
+
+static void BM_SievePrimes(benchmark::State& state) {
+    SegmentedSieve sieve(state.range(0));
+    const uint64_t start = sieveStart(state.range(1));
+    const uint64_t length = state.range(2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sieve.primes(start, start + length).data());
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+}
+
+// Arguments are the number of threads, the start of the range (0 or 10^k)
+// and its length. Throughput is reported in numbers sieved per second
+BENCHMARK(BM_SieveCount)->ArgsProduct({{1, 2, 4}, {0, 9, 12}, {100000000}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SieveCount)->ArgsProduct({{1, 4}, {0}, {1000000000}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SievePrimes)->ArgsProduct({{1, 4}, {0, 12}, {10000000}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_PrimeCount(benchmark::State& state) {
+    PrimeCounter counter(state.range(0));
+    uint64_t x = 1;
+    for (int64_t k = 0; k < state.range(1); ++k) {
+        x *= 10;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(counter.pi(x));
+    }
+}
+
+// Arguments are the number of threads and k, for pi(10^k), to compare with
+// BM_SieveCount up to 10^9
+BENCHMARK(BM_PrimeCount)->ArgsProduct({{1, 4}, {10, 11, 12, 13}})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_PrimeCount)->ArgsProduct({{1, 4}, {14, 15}})->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Index of the primes below 10^9, built once for all the index benchmarks
+static PrimeNumberDetectorIndex& primeIndex() {
+    static const std::string path = (std::filesystem::temp_directory_path() / "pco_bench_primes.idx").string();
+    static std::unique_ptr<PrimeNumberDetectorIndex> index;
+    if (!index) {
+        PrimeNumberDetectorIndex::build(path, 1000000000, std::max(std::thread::hardware_concurrency(), 1u));
+        index = std::make_unique<PrimeNumberDetectorIndex>(path);
+        // The mapping stays valid once the file is removed
+        std::remove(path.c_str());
+    }
+    return *index;
+}
+
+static void BM_IndexCount(benchmark::State& state) {
+    PrimeNumberDetectorIndex& index = primeIndex();
+    const uint64_t length = state.range(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.countPrimes(0, length));
+    }
+    state.SetItemsProcessed(state.iterations() * length);
+}
+
+static void BM_IndexIsPrime(benchmark::State& state) {
+    PrimeNumberDetectorIndex& index = primeIndex();
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<uint64_t> distribution(0, index.limit() - 1);
+    std::vector<uint64_t> numbers(4096);
+    for (uint64_t& number : numbers) {
+        number = distribution(generator);
+    }
+    for (auto _ : state) {
+        for (uint64_t number : numbers) {
+            benchmark::DoNotOptimize(index.isPrime(number));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+}
+
+// Argument is the length of the range counted from 0, to compare with
+// BM_SieveCount
+BENCHMARK(BM_IndexCount)->Arg(100000000)->Arg(1000000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+// Random numbers below the limit of the index, to compare with BM_MillerRabin
+BENCHMARK(BM_IndexIsPrime)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
 BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::PerfCounters(bool enabled) {
+#ifdef __linux__
+    if (!enabled) {
+        return;
+    }
+    const struct {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+    } events[] = {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    };
+    for (const auto &event : events) {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = event.type;
+        attributes.config = event.config;
+        attributes.inherit = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+        if (fd >= 0) {
+            counters.emplace_back(event.name, fd);
+        }
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const auto &counter : counters) {
+        close(counter.second);
+    }
+#endif
+}
+
+std::vector<std::pair<std::string, uint64_t>> PerfCounters::read() const {
+    std::vector<std::pair<std::string, uint64_t>> values;
+#ifdef __linux__
+    for (const auto &counter : counters) {
+        uint64_t value = 0;
+        if (::read(counter.second, &value, sizeof(value)) == sizeof(value)) {
+            values.emplace_back(counter.first, value);
+        }
+    }
+#endif
+    return values;
+}
@@ -0,0 +1,42 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Hardware and software event counters of the process, read with
+ *        perf_event_open()
+ *
+ * The counters are opened with inheritance, so they also count the
+ * threads created after the construction, such as the threads of a
+ * detector, once these threads have terminated. A counter that cannot be
+ * opened (no PMU in a virtual machine, perf_event_paranoid too high, other
+ * system than Linux) is silently left out.
+ */
+class PerfCounters {
+public:
+    /**
+     * @brief Open and start the counters
+     * @param enabled If false, nothing is opened and read() returns nothing
+     */
+    explicit PerfCounters(bool enabled);
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * @brief Names and values of the counters that could be opened
+     */
+    std::vector<std::pair<std::string, uint64_t>> read() const;
+
+private:
+    std::vector<std::pair<std::string, int>> counters;
+};
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,201 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+// Scaling benchmark of the prime number detectors.
+//
+// The inputs are grouped by bit width (16 to 64) and by kind: primes,
+// products of two primes of half the width, and products of primes below
+// 100. Each multi-threaded detector is run with 1, 2, 4, ... threads up to
+// the hardware concurrency, and reports its speedup and its parallel
+// efficiency with respect to its single-threaded run.
+//
+// Options:
+//   --perf_counters   add cycles, instructions, cache misses and context
+//                     switches per number, when perf_event_open() allows it
+//   --benchmark_format=json or --benchmark_out=<file>
+//   --benchmark_out_format=json
+//                     write the results, counters included, as JSON for
+//                     regression tracking
+//   --benchmark_filter=<regex>
+//                     select the detectors, widths or kinds to run
+
+#include <benchmark/benchmark.h>
+
+#include "perfcounters.h"
+#include "primenumberdetector.h"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char *kindNames[] = {"prime", "semiprime", "smooth"};
+
+// Trial division is limited to this width, above it takes seconds per number
+const int maxTrialDivisionBits = 48;
+
+const size_t numbersPerSet = 8;
+
+bool perfCountersEnabled = false;
+
+// Seconds per iteration of the single-threaded run of each benchmark
+std::map<std::string, double> baselines;
+
+PrimeNumberDetectorMillerRabin millerRabin;
+
+// A random prime of exactly the given number of bits
+uint64_t randomPrime(int bits, std::mt19937_64 &generator) {
+    const uint64_t top = uint64_t{1} << (bits - 1);
+    const uint64_t mask = bits == 64 ? ~uint64_t{0} : (top << 1) - 1;
+    while (true) {
+        uint64_t number = ((generator() & mask) | top | 1);
+        while (number >= top && !millerRabin.isPrime(number)) {
+            number += 2;
+        }
+        if (number >= top && (bits == 64 || number <= mask)) {
+            return number;
+        }
+    }
+}
+
+std::vector<uint64_t> makeInputs(int bits, int kind) {
+    std::mt19937_64 generator(bits * 3 + kind);
+    std::vector<uint64_t> numbers;
+    while (numbers.size() < numbersPerSet) {
+        if (kind == 0) {
+            numbers.push_back(randomPrime(bits, generator));
+        }
+        else if (kind == 1) {
+            numbers.push_back(randomPrime(bits / 2, generator) * randomPrime(bits - bits / 2, generator));
+        }
+        else {
+            // Odd primes below 100, so that the detectors do not stop on 2
+            static const uint64_t primes[] = {3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+                                              59, 61, 67, 71, 73, 79, 83, 89, 97};
+            const uint64_t limit = bits == 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+            uint64_t number = 1;
+            while (true) {
+                const uint64_t p = primes[generator() % std::size(primes)];
+                if (number > limit / p) {
+                    break;
+                }
+                number *= p;
+            }
+            numbers.push_back(number);
+        }
+    }
+    return numbers;
+}
+
+using DetectorFactory = std::function<std::unique_ptr<PrimeNumberDetectorInterface>(size_t)>;
+
+void runDetector(benchmark::State &state, const std::string &key, const DetectorFactory &factory,
+                 const std::vector<uint64_t> &numbers, size_t nbThreads) {
+    // The counters are opened before the detector, so that its threads
+    // inherit them, and read once its threads are joined
+    PerfCounters counters(perfCountersEnabled);
+    double seconds = 0;
+    {
+        std::unique_ptr<PrimeNumberDetectorInterface> detector = factory(nbThreads);
+        const auto start = std::chrono::steady_clock::now();
+        for (auto _ : state) {
+            for (uint64_t number : numbers) {
+                benchmark::DoNotOptimize(detector->isPrime(number));
+            }
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const double perIteration = seconds / state.iterations();
+    const double nbNumbers = static_cast<double>(state.iterations()) * numbers.size();
+    state.SetItemsProcessed(state.iterations() * numbers.size());
+    if (nbThreads == 1) {
+        baselines[key] = perIteration;
+    }
+    if (baselines.count(key) != 0) {
+        const double speedup = baselines[key] / perIteration;
+        state.counters["speedup"] = speedup;
+        state.counters["efficiency"] = speedup / nbThreads;
+    }
+    for (const auto &counter : counters.read()) {
+        state.counters[counter.first + "_per_number"] = counter.second / nbNumbers;
+    }
+}
+
+void registerBenchmarks() {
+    const size_t maxThreads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> threadCounts;
+    for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    const std::vector<std::pair<std::string, DetectorFactory>> multiThreaded = {
+        {"MultiThread", [](size_t threads) {
+            return std::make_unique<PrimeNumberDetectorMultiThread>(threads);
+        }},
+        {"MultiThreadWheelDynamic", [](size_t threads) {
+            return std::make_unique<PrimeNumberDetectorMultiThread>(
+                threads, PrimeNumberDetectorMultiThread::Scheduling::Dynamic, PrimeNumberDetectorMultiThread::Kernel::Wheel);
+        }},
+    };
+    const DetectorFactory millerRabinFactory = [](size_t) {
+        return std::make_unique<PrimeNumberDetectorMillerRabin>();
+    };
+
+    for (int bits = 16; bits <= 64; bits += 8) {
+        for (int kind = 0; kind < 3; ++kind) {
+            const auto numbers = std::make_shared<std::vector<uint64_t>>(makeInputs(bits, kind));
+            const std::string suffix = "/" + std::to_string(bits) + "bits/" + kindNames[kind];
+
+            if (bits <= maxTrialDivisionBits) {
+                for (const auto &detector : multiThreaded) {
+                    const std::string key = detector.first + suffix;
+                    for (size_t threads : threadCounts) {
+                        const std::string name = key + "/threads:" + std::to_string(threads);
+                        const DetectorFactory factory = detector.second;
+                        benchmark::RegisterBenchmark(name.c_str(), [=](benchmark::State &state) {
+                            runDetector(state, key, factory, *numbers, threads);
+                        })->Unit(benchmark::kMicrosecond)->UseRealTime();
+                    }
+                }
+            }
+
+            const std::string key = "MillerRabin" + suffix;
+            benchmark::RegisterBenchmark(key.c_str(), [=](benchmark::State &state) {
+                runDetector(state, key, millerRabinFactory, *numbers, 1);
+            })->Unit(benchmark::kMicrosecond)->UseRealTime();
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    // Our own option is removed before the benchmark library parses the others
+    int kept = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--perf_counters") == 0) {
+            perfCountersEnabled = true;
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    registerBenchmarks();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+// Writes the primes of a file of numbers, in the order of the file.
+//
+// Usage: main_filter [options] <input> [output]
+//   --binary            64-bit numbers in the byte order of the machine,
+//                       instead of decimal numbers separated by new lines
+//   --threads <n>       number of threads (default: hardware concurrency)
+//   --detector <name>   miller-rabin (default), inverse, wheel or trial
+//   --chunk <n>         numbers per chunk (default: 65536)
+//
+// The primes are written to the output file, or to the standard output, in
+// the format of the input. The throughput is printed on the error output.
+
+#include "primefilter.h"
+#include "primenumberdetector.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program
+              << " [--binary] [--threads n] [--detector miller-rabin|inverse|wheel|trial] [--chunk n] <input> [output]"
+              << std::endl;
+}
+
+static std::unique_ptr<PrimeNumberDetectorInterface> makeDetector(const std::string &name)
+{
+    if (name == "miller-rabin")
+    {
+        return std::make_unique<PrimeNumberDetectorMillerRabin>();
+    }
+    if (name == "inverse")
+    {
+        return std::make_unique<PrimeNumberDetectorInverse>();
+    }
+    if (name == "wheel")
+    {
+        return std::make_unique<PrimeNumberDetectorWheel>();
+    }
+    if (name == "trial")
+    {
+        return std::make_unique<PrimeNumberDetector>();
+    }
+    return nullptr;
+}
+
+int main(int argc, char *argv[])
+{
+    PrimeFilter::Format format = PrimeFilter::Format::Text;
+    size_t nbThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t chunkNumbers = 1 << 16;
+    std::string detectorName = "miller-rabin";
+    std::string inputPath;
+    std::string outputPath;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string argument = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (argument == "--binary")
+            {
+                format = PrimeFilter::Format::Binary;
+            }
+            else if (argument == "--threads" && hasValue)
+            {
+                nbThreads = std::stoul(argv[++i]);
+            }
+            else if (argument == "--chunk" && hasValue)
+            {
+                chunkNumbers = std::stoul(argv[++i]);
+            }
+            else if (argument == "--detector" && hasValue)
+            {
+                detectorName = argv[++i];
+            }
+            else if (inputPath.empty() && argument.rfind("--", 0) != 0)
+            {
+                inputPath = argument;
+            }
+            else if (outputPath.empty() && argument.rfind("--", 0) != 0)
+            {
+                outputPath = argument;
+            }
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    }
+    catch (const std::logic_error &)
+    {
+        // Thrown by std::stoul on an invalid number
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<PrimeNumberDetectorInterface> detector = makeDetector(detectorName);
+    if (inputPath.empty() || !detector)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *output = stdout;
+    if (!outputPath.empty())
+    {
+        output = std::fopen(outputPath.c_str(), format == PrimeFilter::Format::Binary ? "wb" : "w");
+        if (output == nullptr)
+        {
+            std::cerr << "Cannot open " << outputPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+    }
+
+    int status = 0;
+    try
+    {
+        PrimeFilter filter(*detector, nbThreads, chunkNumbers);
+        const PrimeFilter::Statistics statistics = filter.run(inputPath, format, output);
+        std::cerr << statistics.nbNumbers << " numbers, " << statistics.nbPrimes << " primes in "
+                  << statistics.seconds << " s: "
+                  << (statistics.seconds > 0 ? statistics.nbNumbers / statistics.seconds : 0) << " numbers/s"
+                  << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        status = 1;
+    }
+
+    if (output != stdout && std::fclose(output) != 0)
+    {
+        std::cerr << "Cannot write " << outputPath << ": " << std::strerror(errno) << std::endl;
+        status = 1;
+    }
+    return status;
+}
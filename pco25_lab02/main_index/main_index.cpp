@@ -0,0 +1,82 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+// Builds and queries a file indexing the primes below a limit.
+//
+// Usage: main_index build <index> <limit> [--threads <n>]
+//        main_index count <index> <lower> <upper>
+//        main_index test <index> <number>...
+//
+// build sieves [0, limit) and writes the index, count prints the number of
+// primes in [lower, upper) and test prints, for each number, whether it is
+// prime. The numbers beyond the limit are computed instead of read.
+
+#include "primenumberindex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " build <index> <limit> [--threads n]" << std::endl
+              << "       " << program << " count <index> <lower> <upper>" << std::endl
+              << "       " << program << " test <index> <number>..." << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    const std::string command = argv[1];
+    const std::string indexPath = argv[2];
+
+    try
+    {
+        if (command == "build" && (argc == 4 || (argc == 6 && std::string(argv[4]) == "--threads")))
+        {
+            const uint64_t limit = std::stoull(argv[3]);
+            const size_t nbThreads = argc == 6 ? std::stoul(argv[5]) : std::max(std::thread::hardware_concurrency(), 1u);
+            const auto start = std::chrono::steady_clock::now();
+            const uint64_t nbPrimes = PrimeNumberDetectorIndex::build(indexPath, limit, nbThreads);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << nbPrimes << " primes below " << limit << ", indexed in " << seconds << " s" << std::endl;
+        }
+        else if (command == "count" && argc == 5)
+        {
+            PrimeNumberDetectorIndex index(indexPath);
+            std::cout << index.countPrimes(std::stoull(argv[3]), std::stoull(argv[4])) << std::endl;
+        }
+        else if (command == "test")
+        {
+            PrimeNumberDetectorIndex index(indexPath);
+            for (int i = 3; i < argc; ++i)
+            {
+                const uint64_t number = std::stoull(argv[i]);
+                std::cout << number << (index.isPrime(number) ? " is prime" : " is not prime") << std::endl;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    catch (const std::logic_error &)
+    {
+        // Thrown by std::stoull on an invalid number
+        usage(argv[0]);
+        return 1;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
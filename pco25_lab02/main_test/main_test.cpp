@@ -0,0 +1,1227 @@
+// Authors: Nicolas Reymond, Nadia Cattin
+
+#include <gtest/gtest.h>
+
+#include "factorizer.h"
+#include "logging.h"
+#include "primenumberasync.h"
+#include "primecounter.h"
+#include "primefilter.h"
+#include "primenumbercache.h"
+#include "primenumberdetector.h"
+#include "primenumberdetector128.h"
+#include "primenumberdetectort.h"
+#include "primenumberindex.h"
+#include "segmentedsieve.h"
+#include "smallprimefilter.h"
+#include "threadplacement.h"
+#include "uint128.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+// Simple sieve of Eratosthenes, the reference of the tests
+std::vector<bool> referenceSieve(uint64_t limit)
+{
+    std::vector<bool> prime(limit, true);
+    for (uint64_t n = 0; n < 2 && n < limit; ++n)
+    {
+        prime[n] = false;
+    }
+    for (uint64_t p = 2; p * p < limit; ++p)
+    {
+        if (prime[p])
+        {
+            for (uint64_t m = p * p; m < limit; m += p)
+            {
+                prime[m] = false;
+            }
+        }
+    }
+    return prime;
+}
+
+const uint64_t sieveLimit = 2000000;
+
+const std::vector<bool> &smallSieve()
+{
+    static const std::vector<bool> sieve = referenceSieve(sieveLimit);
+    return sieve;
+}
+
+// Checks every number below sieveLimit. The single-thread trial division
+// detectors exclude the even numbers, 2 included
+void expectMatchesSieve(PrimeNumberDetectorInterface &detector, bool twoIsPrime)
+{
+    const std::vector<bool> &sieve = smallSieve();
+    for (uint64_t n = 0; n < sieveLimit; ++n)
+    {
+        const bool expected = sieve[n] && (twoIsPrime || n != 2);
+        ASSERT_EQ(detector.isPrime(n), expected) << "n = " << n;
+    }
+}
+
+// Primes and products of two primes whose divisor range is split among the
+// threads of PrimeNumberDetectorMultiThread
+const uint64_t largePrimes[] = {100000000000031, 1000000000000037, 4294967291};
+const uint64_t largeComposites[] = {100000980001501, 1000036000099, 1000000000000035};
+
+} // namespace
+
+TEST(PrimeNumberDetectorMultiThread, MatchesSieve)
+{
+    // Req: every thread count gives the answers of a sieve
+    for (size_t nbThreads : {1, 4})
+    {
+        PrimeNumberDetectorMultiThread detector(nbThreads);
+        expectMatchesSieve(detector, true);
+    }
+}
+
+TEST(PrimeNumberDetectorMultiThread, SplitsLargeNumbers)
+{
+    // Req: the numbers tested by the pool keep their answer, and the pool
+    // can be reused from one call to the next
+    PrimeNumberDetectorMultiThread detector(4);
+    for (int round = 0; round < 2; ++round)
+    {
+        for (uint64_t n : largePrimes)
+        {
+            EXPECT_TRUE(detector.isPrime(n)) << "n = " << n;
+        }
+        for (uint64_t n : largeComposites)
+        {
+            EXPECT_FALSE(detector.isPrime(n)) << "n = " << n;
+        }
+    }
+}
+
+TEST(PrimeNumberDetectorMillerRabin, MatchesSieve)
+{
+    // Req: the answers are exact, 2 included
+    PrimeNumberDetectorMillerRabin detector;
+    expectMatchesSieve(detector, true);
+}
+
+TEST(PrimeNumberDetectorMillerRabin, LargeNumbers)
+{
+    // Req: strong pseudoprimes to the first bases are composite, and the
+    // products modulo numbers close to 2^64 do not overflow
+    PrimeNumberDetectorMillerRabin detector;
+    // Strong pseudoprimes to the bases 2, 3, 5, 7, and to the primes up to 37
+    EXPECT_FALSE(detector.isPrime(3215031751));
+    EXPECT_FALSE(detector.isPrime(3825123056546413051));
+    // Carmichael number
+    EXPECT_FALSE(detector.isPrime(561));
+    // Largest 64-bit prime, and its neighbours
+    EXPECT_TRUE(detector.isPrime(18446744073709551557ull));
+    EXPECT_FALSE(detector.isPrime(18446744073709551615ull));
+    EXPECT_FALSE(detector.isPrime(18446744073709551559ull));
+    for (uint64_t n : largePrimes)
+    {
+        EXPECT_TRUE(detector.isPrime(n)) << "n = " << n;
+    }
+    for (uint64_t n : largeComposites)
+    {
+        EXPECT_FALSE(detector.isPrime(n)) << "n = " << n;
+    }
+}
+
+namespace
+{
+
+// Small numbers, then random numbers of up to 40 bits, quick enough for trial
+// division, in a batch whose size is not a multiple of the vector width
+std::vector<uint64_t> mixedBatch()
+{
+    std::vector<uint64_t> batch;
+    for (uint64_t n = 0; n < 1000; ++n)
+    {
+        batch.push_back(n);
+    }
+    std::mt19937_64 generator(42);
+    for (int i = 0; i < 2001; ++i)
+    {
+        batch.push_back(generator() >> (24 + generator() % 40));
+    }
+    for (uint64_t n : largePrimes)
+    {
+        batch.push_back(n);
+    }
+    return batch;
+}
+
+} // namespace
+
+TEST(SmallPrimeFilter, MatchesIsCandidate)
+{
+    // Req: the vectorized filter keeps exactly the numbers kept one by one,
+    // and never rejects a prime
+    const std::vector<uint64_t> batch = mixedBatch();
+    PrimeNumberDetectorMillerRabin reference;
+    for (size_t n : {batch.size(), size_t{1}, size_t{7}, size_t{0}})
+    {
+        std::unique_ptr<bool[]> candidate(new bool[batch.size()]);
+        size_t nbCandidates = SmallPrimeFilter::filter(batch.data(), candidate.get(), n);
+        size_t expected = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            EXPECT_EQ(candidate[i], SmallPrimeFilter::isCandidate(batch[i])) << "n = " << batch[i];
+            if (reference.isPrime(batch[i]))
+            {
+                EXPECT_TRUE(candidate[i]) << "n = " << batch[i];
+            }
+            expected += candidate[i];
+        }
+        EXPECT_EQ(nbCandidates, expected);
+    }
+}
+
+TEST(PrimeNumberDetectorInterface, BatchMatchesIsPrime)
+{
+    // Req: isPrimeBatch() gives the answers of isPrime(), for the default
+    // implementation and for the multi-threaded one
+    const std::vector<uint64_t> batch = mixedBatch();
+    std::vector<std::unique_ptr<PrimeNumberDetectorInterface>> detectors;
+    detectors.emplace_back(new PrimeNumberDetectorMillerRabin);
+    detectors.emplace_back(new PrimeNumberDetectorMultiThread(1));
+    detectors.emplace_back(new PrimeNumberDetectorMultiThread(4));
+    for (const auto &detector : detectors)
+    {
+        std::unique_ptr<bool[]> out(new bool[batch.size()]);
+        detector->isPrimeBatch(batch.data(), out.get(), batch.size());
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            EXPECT_EQ(out[i], detector->isPrime(batch[i])) << "n = " << batch[i];
+        }
+    }
+}
+
+TEST(SegmentedSieve, MatchesSieve)
+{
+    // Req: every range, thread count and segment size gives the primes of
+    // the range, and the bitmap has a bit for each odd number
+    const std::vector<bool> &sieve = smallSieve();
+    std::mt19937_64 generator(7);
+    for (size_t nbThreads : {1, 3})
+    {
+        // 8 bytes is the smallest segment, 1000 is rounded up to 1008
+        for (size_t segmentBytes : {0, 8, 1000})
+        {
+            SegmentedSieve segmentedSieve(nbThreads, segmentBytes);
+            for (int i = 0; i < 50; ++i)
+            {
+                const uint64_t lower = i < 10 ? i : generator() % sieveLimit;
+                const uint64_t upper = std::min(lower + generator() % 300000, sieveLimit);
+                std::vector<uint64_t> expected;
+                for (uint64_t n = lower; n < upper; ++n)
+                {
+                    if (sieve[n])
+                    {
+                        expected.push_back(n);
+                    }
+                }
+                EXPECT_EQ(segmentedSieve.primes(lower, upper), expected) << "[" << lower << ", " << upper << ")";
+                EXPECT_EQ(segmentedSieve.countPrimes(lower, upper), expected.size());
+            }
+
+            std::vector<uint8_t> bitmap((sieveLimit / 2 + 7) / 8);
+            uint64_t count = segmentedSieve.oddBitmap(sieveLimit, bitmap.data());
+            EXPECT_EQ(count, segmentedSieve.countPrimes(0, sieveLimit));
+            for (uint64_t n = 1; n < sieveLimit; n += 2)
+            {
+                ASSERT_EQ((bitmap[n / 16] >> (n / 2 % 8)) & 1, sieve[n]) << "n = " << n;
+            }
+        }
+    }
+}
+
+TEST(SegmentedSieve, KnownCounts)
+{
+    // Req: pi(x) for powers of 10, and a range far from 0
+    SegmentedSieve segmentedSieve(4);
+    EXPECT_EQ(segmentedSieve.countPrimes(0, 1000000000), 50847534u);
+    EXPECT_EQ(segmentedSieve.countPrimes(1000000000000, 1000001000000), 36249u);
+    EXPECT_EQ(segmentedSieve.countPrimes(5, 5), 0u);
+    EXPECT_EQ(segmentedSieve.countPrimes(7, 3), 0u);
+}
+
+TEST(SegmentedSieve, RoughNumbersEndingAt2To64)
+{
+    // Req: the multiples of the sieving primes are computed without
+    // overflow up to 2^64 - 1. Small segments put primes above twice their
+    // size at the last segment, where the wrap happened
+    const std::vector<bool> &sieve = smallSieve();
+    const uint64_t maxFactor = 1 << 16;
+    const uint64_t upper = std::numeric_limits<uint64_t>::max();
+    for (size_t segmentBytes : {8, 1000})
+    {
+        SegmentedSieve segmentedSieve(2, segmentBytes);
+        for (uint64_t lower : {upper - 615, upper - 100000})
+        {
+            uint64_t expected = 0;
+            for (uint64_t n = lower | 1; n < upper; n += 2)
+            {
+                bool rough = true;
+                for (uint64_t p = 3; p <= maxFactor && rough; p += 2)
+                {
+                    rough = !sieve[p] || n % p != 0;
+                }
+                expected += rough;
+            }
+            EXPECT_EQ(segmentedSieve.countRough(lower, upper, maxFactor), expected) << "[" << lower << ", " << upper << ")";
+        }
+    }
+    // Below the square root, the rough numbers are the primes
+    SegmentedSieve segmentedSieve(1);
+    EXPECT_EQ(segmentedSieve.countRough(0, sieveLimit, 1415), segmentedSieve.countPrimes(0, sieveLimit));
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(SegmentedSieve, DISABLED_RangeEndingAt2To64)
+{
+    // Req: the primes of the range ending at 2^64 - 1. Slow, about 15 s and
+    // 1.6 GB: the sieving primes go up to 2^32
+    SegmentedSieve segmentedSieve(1);
+    const uint64_t upper = std::numeric_limits<uint64_t>::max();
+    const uint64_t lower = upper - 615;
+    PrimeNumberDetectorMillerRabin reference;
+    std::vector<uint64_t> expected;
+    for (uint64_t n = lower; n < upper; ++n)
+    {
+        if (reference.isPrime(n))
+        {
+            expected.push_back(n);
+        }
+    }
+    EXPECT_EQ(segmentedSieve.primes(lower, upper), expected);
+}
+
+TEST(PrimeNumberDetectorMultiThread, ConcurrentCalls)
+{
+    // Req: each call has its own cancellation token, so concurrent calls on
+    // one detector neither block nor cancel each other
+    for (auto scheduling : {PrimeNumberDetectorMultiThread::Scheduling::Static,
+                            PrimeNumberDetectorMultiThread::Scheduling::Dynamic})
+    {
+        PrimeNumberDetectorMultiThread detector(3, scheduling);
+        std::vector<std::thread> callers;
+        std::vector<int> nbErrors(4, 0);
+        for (size_t t = 0; t < nbErrors.size(); ++t)
+        {
+            callers.emplace_back([&, t]
+            {
+                for (int round = 0; round < 3; ++round)
+                {
+                    for (uint64_t n : largePrimes)
+                    {
+                        nbErrors[t] += !detector.isPrime(n);
+                    }
+                    for (uint64_t n : largeComposites)
+                    {
+                        nbErrors[t] += detector.isPrime(n);
+                    }
+                }
+            });
+        }
+        for (std::thread &caller : callers)
+        {
+            caller.join();
+        }
+        for (int errors : nbErrors)
+        {
+            EXPECT_EQ(errors, 0);
+        }
+        EXPECT_GE(detector.lastCancellationLatency().count(), 0);
+    }
+}
+
+TEST(PrimeNumberDetectorMultiThread, DynamicScheduling)
+{
+    // Req: the chunks taken from the shared cursor cover every divisor, and
+    // start on odd divisors
+    PrimeNumberDetectorMultiThread detector(4, PrimeNumberDetectorMultiThread::Scheduling::Dynamic);
+    expectMatchesSieve(detector, true);
+    for (uint64_t n : largePrimes)
+    {
+        EXPECT_TRUE(detector.isPrime(n)) << "n = " << n;
+    }
+    for (uint64_t n : largeComposites)
+    {
+        EXPECT_FALSE(detector.isPrime(n)) << "n = " << n;
+    }
+    // Square of a prime, whose only divisor is the last one tested
+    EXPECT_FALSE(detector.isPrime(1000003ull * 1000003ull));
+}
+
+TEST(PrimeNumberDetectorWheel, MatchesSieve)
+{
+    // Req: the table of small primes, then the mod 210 wheel, miss no divisor
+    PrimeNumberDetectorWheel detector;
+    expectMatchesSieve(detector, false);
+    for (uint64_t n : largePrimes)
+    {
+        EXPECT_TRUE(detector.isPrime(n)) << "n = " << n;
+    }
+    for (uint64_t n : largeComposites)
+    {
+        EXPECT_FALSE(detector.isPrime(n)) << "n = " << n;
+    }
+    // Squares of the last prime of the table and of the first wheel divisor
+    // beyond it
+    EXPECT_FALSE(detector.isPrime(65521ull * 65521ull));
+    EXPECT_FALSE(detector.isPrime(65537ull * 65537ull));
+}
+
+TEST(PrimeNumberDetectorMultiThread, WheelKernel)
+{
+    // Req: the wheel kernel gives the answers of the odd one, with both
+    // schedulings
+    for (auto scheduling : {PrimeNumberDetectorMultiThread::Scheduling::Static,
+                            PrimeNumberDetectorMultiThread::Scheduling::Dynamic})
+    {
+        PrimeNumberDetectorMultiThread detector(4, scheduling, PrimeNumberDetectorMultiThread::Kernel::Wheel);
+        expectMatchesSieve(detector, true);
+        for (uint64_t n : largePrimes)
+        {
+            EXPECT_TRUE(detector.isPrime(n)) << "n = " << n;
+        }
+        for (uint64_t n : largeComposites)
+        {
+            EXPECT_FALSE(detector.isPrime(n)) << "n = " << n;
+        }
+        EXPECT_FALSE(detector.isPrime(1000003ull * 1000003ull));
+    }
+}
+
+TEST(PrimeNumberDetectorInverse, MatchesSieve)
+{
+    // Req: the divisibility test by multiplication with the inverse gives
+    // the answers of a division
+    PrimeNumberDetectorInverse detector;
+    expectMatchesSieve(detector, false);
+    for (uint64_t n : largePrimes)
+    {
+        EXPECT_TRUE(detector.isPrime(n)) << "n = " << n;
+    }
+    for (uint64_t n : largeComposites)
+    {
+        EXPECT_FALSE(detector.isPrime(n)) << "n = " << n;
+    }
+    EXPECT_FALSE(detector.isPrime(65521ull * 65521ull));
+    EXPECT_FALSE(detector.isPrime(65537ull * 65537ull));
+    // Multiples of a table prime close to 2^64, where n * inverse wraps
+    EXPECT_FALSE(detector.isPrime(18446744073709551615ull));
+    EXPECT_FALSE(detector.isPrime(65521ull * 281539415968995ull));
+}
+
+TEST(PrimeNumberDetectorMultiThread, IsPrimeWithin)
+{
+    // Req: with time enough, the answers are exact and agree with isPrime();
+    // a passed deadline stops before the deterministic bases and leaves a
+    // probable prime
+    using Primality = PrimeNumberDetectorMultiThread::Primality;
+    using Stage = PrimeNumberDetectorMultiThread::Stage;
+    const auto later = std::chrono::steady_clock::now() + std::chrono::hours(1);
+    PrimeNumberDetectorMultiThread detector(4);
+    const std::vector<bool> &sieve = smallSieve();
+    for (uint64_t n = 0; n < sieveLimit; ++n)
+    {
+        const PrimeNumberDetectorMultiThread::BudgetedResult result = detector.isPrimeWithin(n, later);
+        ASSERT_EQ(result.primality, sieve[n] ? Primality::Prime : Primality::Composite) << "n = " << n;
+        ASSERT_EQ(result.stage, Stage::SmallPrimes) << "n = " << n;
+        ASSERT_EQ(result.confidence, 1.0);
+    }
+    for (uint64_t n : largePrimes)
+    {
+        EXPECT_EQ(detector.isPrimeWithin(n, later).primality, Primality::Prime) << "n = " << n;
+    }
+    for (uint64_t n : largeComposites)
+    {
+        EXPECT_EQ(detector.isPrimeWithin(n, later).primality, Primality::Composite) << "n = " << n;
+    }
+
+    // About 0.7 s of trial division on one thread, microseconds here
+    const uint64_t prime = 99194853094755497;
+    const auto start = std::chrono::steady_clock::now();
+    PrimeNumberDetectorMultiThread::BudgetedResult result
+        = detector.isPrimeWithin(prime, start + std::chrono::milliseconds(5));
+    EXPECT_EQ(result.primality, Primality::Prime);
+    EXPECT_EQ(result.confidence, 1.0);
+    EXPECT_EQ(result.stage, Stage::Deterministic);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(200));
+    // Past the deadline, only the first stage runs
+    result = detector.isPrimeWithin(prime, start);
+    EXPECT_EQ(result.primality, Primality::ProbablyPrime);
+    EXPECT_EQ(result.confidence, 0.0);
+    EXPECT_EQ(result.stage, Stage::SmallPrimes);
+    // A strong pseudoprime to the bases 2 to 23 fails some random base, or
+    // else the deterministic ones
+    EXPECT_EQ(detector.isPrimeWithin(3825123056546413051, later).primality, Primality::Composite);
+
+    // Every call runs the first stage
+    EXPECT_EQ(detector.stageMetrics(Stage::SmallPrimes).first,
+              sieveLimit + std::size(largePrimes) + std::size(largeComposites) + 3);
+}
+
+TEST(PrimeNumberDetectorMultiThread, StageMetricsUnderConcurrentCalls)
+{
+    // Req: the stage totals count every run of every concurrent call
+    PrimeNumberDetectorMultiThread detector(2);
+    const auto later = std::chrono::steady_clock::now() + std::chrono::hours(1);
+    const int nbCallers = 4;
+    const int nbCalls = 20000;
+    std::vector<std::thread> callers;
+    for (int t = 0; t < nbCallers; ++t)
+    {
+        callers.emplace_back([&]
+        {
+            for (int i = 0; i < nbCalls; ++i)
+            {
+                detector.isPrimeWithin(i, later);
+            }
+        });
+    }
+    for (std::thread &caller : callers)
+    {
+        caller.join();
+    }
+    EXPECT_EQ(detector.stageMetrics(PrimeNumberDetectorMultiThread::Stage::SmallPrimes).first,
+              uint64_t{nbCallers} * nbCalls);
+}
+
+TEST(PrimeNumberDetectorCache, AnswersAndCounts)
+{
+    // Req: the cache gives the answers of the detector, even once full, and
+    // counts every call as a hit or a miss
+    PrimeNumberDetectorMillerRabin reference;
+    PrimeNumberDetectorCache cache(reference, 1000, 4);
+    const std::vector<bool> &sieve = smallSieve();
+    for (int round = 0; round < 2; ++round)
+    {
+        for (uint64_t n = 0; n < 100000; ++n)
+        {
+            ASSERT_EQ(cache.isPrime(n), sieve[n]) << "n = " << n;
+        }
+    }
+    EXPECT_EQ(cache.hits() + cache.misses(), 200000u);
+    EXPECT_GE(cache.misses(), 100000u);
+
+    // A number read again right away is a hit
+    const uint64_t hits = cache.hits();
+    cache.isPrime(99194853094755497);
+    cache.isPrime(99194853094755497);
+    EXPECT_EQ(cache.hits(), hits + 1);
+}
+
+TEST(PrimeNumberDetectorCache, ConcurrentCallers)
+{
+    // Req: threads sharing the cache and the multi-threaded detector behind
+    // it get the right answers, and no call is lost in the counts
+    PrimeNumberDetectorMultiThread detector(2);
+    PrimeNumberDetectorCache cache(detector, 4096);
+    const std::vector<bool> &sieve = smallSieve();
+    const int nbCallers = 4;
+    const uint64_t nbNumbers = 50000;
+    std::vector<int> nbErrors(nbCallers, 0);
+    std::vector<std::thread> callers;
+    for (int t = 0; t < nbCallers; ++t)
+    {
+        callers.emplace_back([&, t]
+        {
+            std::mt19937_64 generator(t);
+            for (uint64_t i = 0; i < nbNumbers; ++i)
+            {
+                const uint64_t n = generator() % 10000;
+                nbErrors[t] += cache.isPrime(n) != sieve[n];
+            }
+            nbErrors[t] += !cache.isPrime(largePrimes[0]);
+        });
+    }
+    for (std::thread &caller : callers)
+    {
+        caller.join();
+    }
+    for (int errors : nbErrors)
+    {
+        EXPECT_EQ(errors, 0);
+    }
+    EXPECT_EQ(cache.hits() + cache.misses(), nbCallers * (nbNumbers + 1));
+}
+
+namespace
+{
+
+// Checks that the factors are primes, in increasing order, whose product is
+// the number
+void expectFactorization(const std::vector<uint64_t> &factors, uint64_t number)
+{
+    PrimeNumberDetectorMillerRabin reference;
+    unsigned __int128 product = 1;
+    for (size_t i = 0; i < factors.size(); ++i)
+    {
+        EXPECT_TRUE(reference.isPrime(factors[i])) << factors[i] << " in the factors of " << number;
+        if (i > 0)
+        {
+            EXPECT_LE(factors[i - 1], factors[i]) << "factors of " << number;
+        }
+        product *= factors[i];
+    }
+    EXPECT_TRUE(product == number) << "factors of " << number;
+}
+
+} // namespace
+
+TEST(Factorizer, SmallNumbers)
+{
+    // Req: every number below 1e5 is decomposed, 0 and 1 into no factor
+    Factorizer factorizer;
+    EXPECT_TRUE(factorizer.factorize(0).empty());
+    EXPECT_TRUE(factorizer.factorize(1).empty());
+    for (uint64_t n = 2; n < 100000; ++n)
+    {
+        expectFactorization(factorizer.factorize(n), n);
+    }
+}
+
+TEST(Factorizer, LargeNumbers)
+{
+    // Req: products of large primes, squares and powers, and random 64-bit
+    // numbers are decomposed, with one thread or several
+    const std::vector<std::vector<uint64_t>> known = {
+        {4294967279, 4294967291},
+        {1000003, 1000003},
+        {3, 5, 17, 257, 641, 65537, 6700417},
+        {149491, 747451, 34233211},
+        {18446744073709551557ull},
+        std::vector<uint64_t>(63, 2),
+    };
+    for (size_t nbThreads : {1, 4})
+    {
+        Factorizer factorizer(nbThreads);
+        for (const std::vector<uint64_t> &factors : known)
+        {
+            uint64_t n = 1;
+            for (uint64_t factor : factors)
+            {
+                n *= factor;
+            }
+            EXPECT_EQ(factorizer.factorize(n), factors) << "n = " << n;
+        }
+
+        std::mt19937_64 generator(3);
+        for (int i = 0; i < 200; ++i)
+        {
+            const uint64_t n = generator();
+            expectFactorization(factorizer.factorize(n), n);
+        }
+    }
+}
+
+namespace
+{
+
+std::string readAll(FILE *file)
+{
+    std::string content;
+    std::rewind(file);
+    char buffer[4096];
+    size_t length;
+    while ((length = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        content.append(buffer, length);
+    }
+    return content;
+}
+
+} // namespace
+
+TEST(PrimeFilter, TextAndBinary)
+{
+    // Req: the primes of the file are written in its order and format,
+    // whatever the chunk size, including numbers cut by a chunk boundary
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::filesystem::path textPath = directory / "pco_lab02_filter_test.txt";
+    const std::filesystem::path binaryPath = directory / "pco_lab02_filter_test.bin";
+
+    std::mt19937_64 generator(11);
+    std::vector<uint64_t> numbers;
+    for (int i = 0; i < 20000; ++i)
+    {
+        numbers.push_back(generator() >> (generator() % 64));
+    }
+    numbers.push_back(18446744073709551557ull);
+    std::string text;
+    std::string expectedText;
+    std::vector<uint64_t> expectedPrimes;
+    PrimeNumberDetectorMillerRabin reference;
+    for (uint64_t n : numbers)
+    {
+        text += std::to_string(n) + (n % 3 == 0 ? " " : "\n");
+        if (reference.isPrime(n))
+        {
+            expectedText += std::to_string(n) + "\n";
+            expectedPrimes.push_back(n);
+        }
+    }
+    std::ofstream(textPath) << text;
+    std::ofstream(binaryPath, std::ios::binary)
+        .write(reinterpret_cast<const char *>(numbers.data()), numbers.size() * sizeof(uint64_t));
+
+    for (size_t chunkNumbers : {1, 7, 1 << 16})
+    {
+        PrimeFilter filter(reference, 3, chunkNumbers);
+
+        FILE *output = std::tmpfile();
+        ASSERT_NE(output, nullptr);
+        PrimeFilter::Statistics statistics = filter.run(textPath.string(), PrimeFilter::Format::Text, output);
+        EXPECT_EQ(statistics.nbNumbers, numbers.size());
+        EXPECT_EQ(statistics.nbPrimes, expectedPrimes.size());
+        EXPECT_EQ(readAll(output), expectedText) << "chunk of " << chunkNumbers;
+        std::fclose(output);
+
+        output = std::tmpfile();
+        ASSERT_NE(output, nullptr);
+        statistics = filter.run(binaryPath.string(), PrimeFilter::Format::Binary, output);
+        EXPECT_EQ(statistics.nbPrimes, expectedPrimes.size());
+        const std::string binary = readAll(output);
+        EXPECT_EQ(binary, std::string(reinterpret_cast<const char *>(expectedPrimes.data()),
+                                      expectedPrimes.size() * sizeof(uint64_t)))
+            << "chunk of " << chunkNumbers;
+        std::fclose(output);
+    }
+
+    std::filesystem::remove(textPath);
+    std::filesystem::remove(binaryPath);
+    EXPECT_THROW(PrimeFilter(reference, 1).run(textPath.string(), PrimeFilter::Format::Text, stdout),
+                 std::runtime_error);
+}
+
+TEST(PrimeNumberDetectorIndex, MatchesSieve)
+{
+    // Req: the index answers like a sieve below its limit, 2 included, and
+    // like Miller-Rabin beyond it; the counts of the ranges that straddle
+    // the limit add the sieved part
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "pco_lab02_index_test.idx";
+    const uint64_t limit = 1000001;
+    const std::vector<bool> &sieve = smallSieve();
+    uint64_t expectedCount = 0;
+    for (uint64_t n = 0; n < limit; ++n)
+    {
+        expectedCount += sieve[n];
+    }
+    EXPECT_EQ(PrimeNumberDetectorIndex::build(path.string(), limit, 2), expectedCount);
+
+    {
+        PrimeNumberDetectorIndex index(path.string());
+        EXPECT_EQ(index.limit(), limit);
+        for (uint64_t n = 0; n < sieveLimit; ++n)
+        {
+            ASSERT_EQ(index.isPrime(n), sieve[n]) << "n = " << n;
+        }
+        EXPECT_TRUE(index.isPrime(18446744073709551557ull));
+
+        std::mt19937_64 generator(13);
+        for (int i = 0; i < 200; ++i)
+        {
+            const uint64_t lower = generator() % sieveLimit;
+            const uint64_t upper = std::min(lower + generator() % 600000, sieveLimit);
+            uint64_t expected = 0;
+            for (uint64_t n = lower; n < upper; ++n)
+            {
+                expected += sieve[n];
+            }
+            ASSERT_EQ(index.countPrimes(lower, upper), expected) << "[" << lower << ", " << upper << ")";
+        }
+    }
+
+    // A file that is not an index is rejected
+    std::ofstream(path) << "not an index, but long enough to hold a header of 64 bytes...........";
+    EXPECT_THROW(PrimeNumberDetectorIndex index(path.string()), std::runtime_error);
+    std::filesystem::remove(path);
+    EXPECT_THROW(PrimeNumberDetectorIndex index(path.string()), std::runtime_error);
+}
+
+TEST(PrimeNumberDetectorAsync, ConcurrentClients)
+{
+    // Req: the numbers submitted by concurrent clients get the answers of
+    // the multi-threaded detector, whichever batch they end up in
+    PrimeNumberDetectorMultiThread reference(1);
+    const int nbClients = 6;
+    std::vector<int> nbErrors(nbClients, 0);
+    PrimeNumberDetectorAsync detector(3, 16);
+    std::vector<std::thread> clients;
+    for (int c = 0; c < nbClients; ++c)
+    {
+        clients.emplace_back([&, c]
+        {
+            std::mt19937_64 generator(c);
+            std::vector<std::pair<uint64_t, PcoFuture<bool>>> futures;
+            for (int i = 0; i < 300; ++i)
+            {
+                // Small numbers, and large ones whose divisors are split
+                const uint64_t n = i % 3 == 0 ? generator() % (uint64_t{1} << 40) : generator() % 100000;
+                futures.emplace_back(n, detector.submit(n));
+            }
+            for (auto &future : futures)
+            {
+                nbErrors[c] += future.second.get() != reference.isPrime(future.first);
+            }
+            for (uint64_t n : largePrimes)
+            {
+                nbErrors[c] += !detector.isPrime(n);
+            }
+        });
+    }
+    for (std::thread &client : clients)
+    {
+        client.join();
+    }
+    for (int errors : nbErrors)
+    {
+        EXPECT_EQ(errors, 0);
+    }
+    EXPECT_GT(detector.nbBatches(), 0u);
+}
+
+TEST(PrimeNumberDetectorAsync, DestructorDrainsQueue)
+{
+    // Req: the numbers submitted before the destruction are still tested,
+    // except the cancelled ones
+    std::vector<PcoFuture<bool>> futures;
+    PcoFuture<bool> cancelled;
+    {
+        PrimeNumberDetectorAsync detector(2, 8);
+        for (int i = 0; i < 100; ++i)
+        {
+            futures.push_back(detector.submit(largePrimes[0]));
+        }
+        cancelled = detector.submit(largeComposites[0]);
+        cancelled.cancel();
+    }
+    for (PcoFuture<bool> &future : futures)
+    {
+        ASSERT_TRUE(future.isReady());
+        EXPECT_TRUE(future.get());
+    }
+    EXPECT_TRUE(cancelled.isCancelled());
+}
+
+TEST(Isqrt, ExactRoots)
+{
+    // Req: the root is exact where the double estimate is not, up to the
+    // largest 64-bit and 128-bit numbers
+    for (uint64_t root : {uint64_t{1}, uint64_t{94906265}, uint64_t{3037000499}, uint64_t{4294967295}})
+    {
+        EXPECT_EQ(isqrt(root * root), root);
+        EXPECT_EQ(isqrt(root * root - 1), root - 1);
+        if (root < 4294967295)
+        {
+            EXPECT_EQ(isqrt(root * root + 2 * root), root);
+        }
+    }
+    EXPECT_EQ(isqrt(uint64_t{0}), 0u);
+    EXPECT_EQ(isqrt(std::numeric_limits<uint64_t>::max()), 4294967295u);
+
+    for (uint64_t root : {uint64_t{4294967296}, uint64_t{1} << 52 | 1, uint64_t{18446744073709551557ull},
+                          std::numeric_limits<uint64_t>::max()})
+    {
+        const uint128 square = uint128(root) * root;
+        EXPECT_EQ(isqrt(square), root);
+        EXPECT_EQ(isqrt(square - 1), root - 1);
+    }
+    EXPECT_EQ(isqrt(~uint128(0)), std::numeric_limits<uint64_t>::max());
+}
+
+TEST(PrimeNumberDetector128, SmallAndLargeNumbers)
+{
+    // Req: exact below 2^64, 2 included; Baillie-PSW above
+    PrimeNumberDetector128 detector;
+    expectMatchesSieve(detector, true);
+
+    const uint128 one = 1;
+    // Mersenne primes, and the largest prime below 2^128
+    for (uint128 prime : {(one << 61) - 1, (one << 89) - 1, (one << 107) - 1, (one << 127) - 1, ~uint128(0) - 158})
+    {
+        EXPECT_TRUE(detector.isPrime(prime)) << static_cast<uint64_t>(prime >> 64) << ":" << static_cast<uint64_t>(prime);
+    }
+    const uint128 p64 = 18446744073709551557ull;
+    for (uint128 composite : {~uint128(0), (one << 67) - 1, p64 * p64, p64 * ((one << 61) - 1), (one << 127) + 1,
+                              uint128(1000003) * ((one << 89) - 1)})
+    {
+        EXPECT_FALSE(detector.isPrime(composite))
+            << static_cast<uint64_t>(composite >> 64) << ":" << static_cast<uint64_t>(composite);
+    }
+}
+
+TEST(PrimeNumberDetector128, LucasTest)
+{
+    // Req: the strong Lucas test passes the primes and the known strong
+    // Lucas pseudoprimes, and rejects the other odd composites
+    const std::vector<bool> &sieve = smallSieve();
+    const std::vector<uint64_t> pseudoprimes = {5459, 5777, 10877, 16109, 18971, 22499, 24569, 25199, 40309, 58519};
+    for (uint64_t n = 3; n < 60000; n += 2)
+    {
+        const bool pseudoprime = std::find(pseudoprimes.begin(), pseudoprimes.end(), n) != pseudoprimes.end();
+        // The squares are skipped by Selfridge's method
+        if (isqrt(n) * isqrt(n) != n)
+        {
+            EXPECT_EQ(PrimeNumberDetector128::isStrongLucasProbablePrime(n), sieve[n] || pseudoprime) << "n = " << n;
+        }
+    }
+}
+
+TEST(PrimeNumberDetector128, BatchMatchesIsPrime)
+{
+    // Req: the batch shared among the threads gives the answers of isPrime()
+    PrimeNumberDetector128 detector(3);
+    std::mt19937_64 generator(17);
+    std::vector<uint128> batch;
+    for (int i = 0; i < 3000; ++i)
+    {
+        const uint128 n = uint128(generator()) << 64 | generator();
+        batch.push_back(n >> (generator() % 128) | 1);
+    }
+    std::unique_ptr<bool[]> out(new bool[batch.size()]);
+    detector.isPrimeBatch(batch.data(), out.get(), batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        EXPECT_EQ(out[i], detector.isPrime(batch[i]));
+    }
+}
+
+namespace
+{
+
+// Stream buffer keeping what is written to it, read while the writer
+// thread of the logs may still write
+class CaptureBuffer : public std::streambuf
+{
+public:
+    std::string text()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return captured;
+    }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (c != traits_type::eof())
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            captured += traits_type::to_char_type(c);
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        captured.append(s, static_cast<size_t>(n));
+        return n;
+    }
+
+private:
+    std::mutex mutex;
+    std::string captured;
+};
+
+// Redirects what LogFunction() writes to std::cout while alive. The logs
+// are flushed around, so that the writer thread never writes to std::cout
+// while it is redirected
+class LogCapture
+{
+public:
+    LogCapture()
+    {
+        Log::flush();
+        previous = std::cout.rdbuf(&buffer);
+    }
+
+    ~LogCapture()
+    {
+        Log::flush();
+        std::cout.rdbuf(previous);
+        Log::setLevel(LogLevel::Info);
+    }
+
+    // Everything written so far, without flushing
+    std::string written() { return buffer.text(); }
+
+    std::string text()
+    {
+        Log::flush();
+        return buffer.text();
+    }
+
+private:
+    CaptureBuffer buffer;
+    std::streambuf *previous;
+};
+
+int countEvaluation(int &evaluations)
+{
+    return ++evaluations;
+}
+
+} // namespace
+
+TEST(Log, DisabledLevelsAreNotEvaluated)
+{
+    // Req: a statement below the runtime level, or below LOGGING_MIN_LEVEL,
+    // does not evaluate its operands
+    LogCapture capture;
+    int evaluations = 0;
+    Log::setLevel(LogLevel::Info);
+    LOG(LogLevel::Debug) << countEvaluation(evaluations) << std::endl;
+    EXPECT_EQ(evaluations, 0);
+    LOG(LogLevel::Info) << countEvaluation(evaluations) << std::endl;
+    EXPECT_EQ(evaluations, 1);
+
+    // LOGGING_MIN_LEVEL is read where LOG() is used
+    Log::setLevel(LogLevel::Debug);
+#pragma push_macro("LOGGING_MIN_LEVEL")
+#undef LOGGING_MIN_LEVEL
+#define LOGGING_MIN_LEVEL 2
+    LOG(LogLevel::Debug) << countEvaluation(evaluations) << std::endl;
+    LOG(LogLevel::Info) << countEvaluation(evaluations) << std::endl;
+    EXPECT_EQ(evaluations, 1);
+    LOG(LogLevel::Warning) << countEvaluation(evaluations) << std::endl;
+    EXPECT_EQ(evaluations, 2);
+#pragma pop_macro("LOGGING_MIN_LEVEL")
+    LOG(LogLevel::Debug) << countEvaluation(evaluations) << std::endl;
+    EXPECT_EQ(evaluations, 3);
+    LOG(LogLevel::Off) << countEvaluation(evaluations) << std::endl;
+    EXPECT_EQ(evaluations, 3);
+
+    EXPECT_EQ(capture.text(), "1\n2\n3\n");
+}
+
+TEST(Log, FlushWritesEveryLine)
+{
+    // Req: once Log::flush() returns, LogFunction() got every line logged
+    // before, in order, lines larger than a buffer included
+    LogCapture capture;
+    std::string expected;
+    for (int i = 0; i < 20000; ++i)
+    {
+        Logging << "line " << i << std::endl;
+        expected += "line " + std::to_string(i) + "\n";
+    }
+    const std::string large(100000, 'x');
+    Logging << large << std::endl;
+    expected += large + "\n";
+    EXPECT_EQ(capture.text(), expected);
+}
+
+TEST(Log, WriterWakesUpWithoutFlush)
+{
+    // Req: the writer thread, idle while nothing is logged, is woken by a
+    // new line and writes it without a flush
+    LogCapture capture;
+    Logging << "first" << std::endl;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (capture.written().empty() && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(capture.written(), "first\n");
+
+    // Again once it has gone back to sleep
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Logging << "second" << std::endl;
+    while (capture.written().size() < 13 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(capture.written(), "first\nsecond\n");
+}
+
+TEST(Log, ThreadsKeepTheirOrder)
+{
+    // Req: the lines of each thread are written in the order it logged
+    // them, whatever their interleaving with the lines of other threads
+    LogCapture capture;
+    const int nbThreads = 4;
+    const int nbLines = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nbThreads; ++t)
+    {
+        threads.emplace_back([t]
+        {
+            for (int i = 0; i < nbLines; ++i)
+            {
+                Logging << t << " " << i << std::endl;
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    std::istringstream lines(capture.text());
+    std::vector<int> next(nbThreads, 0);
+    int t;
+    int i;
+    while (lines >> t >> i)
+    {
+        ASSERT_TRUE(t >= 0 && t < nbThreads) << "thread " << t;
+        ASSERT_EQ(i, next[t]) << "thread " << t;
+        ++next[t];
+    }
+    EXPECT_EQ(next, std::vector<int>(nbThreads, nbLines));
+}
+
+TEST(PrimeNumberDetectorT, MatchesSieve)
+{
+    // Req: every width is exact, 2 included, for the numbers it holds and
+    // for the wider ones it passes on
+    PrimeNumberDetectorT<16> detector16;
+    PrimeNumberDetectorT<32> detector32;
+    PrimeNumberDetectorT<64> detector64;
+    expectMatchesSieve(detector16, true);
+    expectMatchesSieve(detector32, true);
+    expectMatchesSieve(detector64, true);
+
+    const std::vector<bool> &sieve = smallSieve();
+    for (uint32_t n = 0; n < 65536; ++n)
+    {
+        ASSERT_EQ(PrimeNumberDetectorT<16>::test(static_cast<uint16_t>(n)), sieve[n]) << "n = " << n;
+    }
+}
+
+TEST(PrimeNumberDetectorT, WideNumbers)
+{
+    // Req: the 32-bit and 64-bit kernels agree with Miller-Rabin, near the
+    // end of their width and on strong pseudoprimes to some of their bases
+    PrimeNumberDetectorMillerRabin reference;
+    std::mt19937_64 generator(19);
+    for (int i = 0; i < 100000; ++i)
+    {
+        const uint32_t n32 = static_cast<uint32_t>(generator()) >> (generator() % 16);
+        ASSERT_EQ(PrimeNumberDetectorT<32>::test(n32), reference.isPrime(n32)) << "n = " << n32;
+        const uint64_t n64 = generator() >> (generator() % 32);
+        ASSERT_EQ(PrimeNumberDetectorT<64>::test(n64), reference.isPrime(n64)) << "n = " << n64;
+    }
+    // Strong pseudoprimes to base 2 above the 16-bit table, and numbers
+    // close to 2^32
+    for (uint32_t n : {74665u, 80581u, 85489u, 88357u, 90751u, 4294967295u, 4294967291u, 4294967279u})
+    {
+        EXPECT_EQ(PrimeNumberDetectorT<32>::test(n), reference.isPrime(n)) << "n = " << n;
+    }
+    for (uint64_t n : {uint64_t{3215031751}, uint64_t{3825123056546413051}, uint64_t{18446744073709551557ull},
+                       uint64_t{18446744073709551615ull}, uint64_t{4294967291ull * 4294967279ull}})
+    {
+        EXPECT_EQ(PrimeNumberDetectorT<64>::test(n), reference.isPrime(n)) << "n = " << n;
+        EXPECT_EQ(PrimeNumberDetectorT<16>().isPrime(n), reference.isPrime(n)) << "n = " << n;
+    }
+}
+
+TEST(PrimeCounter, KnownValues)
+{
+    // Req: pi(x) for powers of 10, with one thread or several
+    for (size_t nbThreads : {1, 4})
+    {
+        PrimeCounter counter(nbThreads);
+        EXPECT_EQ(counter.pi(0), 0u);
+        EXPECT_EQ(counter.pi(1), 0u);
+        EXPECT_EQ(counter.pi(2), 1u);
+        EXPECT_EQ(counter.pi(1000000), 78498u);
+        EXPECT_EQ(counter.pi(10000000000), 455052511u);
+        EXPECT_EQ(counter.pi(100000000000), 4118054813u);
+        EXPECT_EQ(counter.pi(1000000000000), 37607912018u);
+    }
+}
+
+TEST(PrimeCounter, MatchesSegmentedSieve)
+{
+    // Req: pi(x) matches a count by sieve, around the switch from sieving to
+    // the Meissel-Lehmer formula and for random x
+    PrimeCounter counter(2);
+    SegmentedSieve segmentedSieve(2);
+    std::vector<uint64_t> values = {(1 << 20) - 1, 1 << 20, (1 << 20) + 1, 99999989, 100000007};
+    std::mt19937_64 generator(23);
+    for (int i = 0; i < 30; ++i)
+    {
+        values.push_back(generator() % 200000000);
+    }
+    for (uint64_t x : values)
+    {
+        EXPECT_EQ(counter.pi(x), segmentedSieve.countPrimes(0, x + 1)) << "x = " << x;
+    }
+}
+
+TEST(CpuTopology, PlacementOrders)
+{
+    // Req: on two nodes of two cores with two SMT siblings each, Compact
+    // fills the siblings first, Scatter the cores of every node first, and
+    // NumaNode gives a whole node per thread
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "pco_lab02_topology_test";
+    std::filesystem::remove_all(root);
+    const auto write = [](const std::filesystem::path &path, const std::string &content)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << content << "\n";
+    };
+    write(root / "cpu" / "online", "0-7");
+    for (int cpu = 0; cpu < 8; ++cpu)
+    {
+        // Linux numbers the second siblings after all the first ones
+        const std::filesystem::path topology = root / "cpu" / ("cpu" + std::to_string(cpu)) / "topology";
+        write(topology / "physical_package_id", std::to_string(cpu / 2 % 2));
+        write(topology / "core_id", std::to_string(cpu % 2));
+    }
+    write(root / "node" / "node0" / "cpulist", "0-1,4-5");
+    write(root / "node" / "node1" / "cpulist", "2-3,6-7");
+
+    const CpuTopology topology(root.string());
+    EXPECT_EQ(topology.cpus().size(), 8u);
+    EXPECT_EQ(topology.nbCores(), 4u);
+    EXPECT_EQ(topology.nbNodes(), 2u);
+    std::vector<int> compact;
+    std::vector<int> scatter;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        compact.push_back(topology.cpusFor(ThreadPlacement::Compact, i).at(0));
+        scatter.push_back(topology.cpusFor(ThreadPlacement::Scatter, i).at(0));
+    }
+    EXPECT_EQ(compact, (std::vector<int>{0, 4, 1, 5, 2, 6, 3, 7}));
+    EXPECT_EQ(scatter, (std::vector<int>{0, 2, 1, 3, 4, 6, 5, 7}));
+    EXPECT_EQ(topology.cpusFor(ThreadPlacement::NumaNode, 0), (std::vector<int>{0, 4, 1, 5}));
+    EXPECT_EQ(topology.cpusFor(ThreadPlacement::NumaNode, 3), (std::vector<int>{2, 6, 3, 7}));
+    EXPECT_TRUE(topology.cpusFor(ThreadPlacement::None, 0).empty());
+
+    // Only the allowed CPUs are kept
+    const CpuTopology restricted(root.string(), {0, 4, 6});
+    EXPECT_EQ(restricted.cpus().size(), 3u);
+    EXPECT_EQ(restricted.nbCores(), 2u);
+    EXPECT_EQ(restricted.cpusFor(ThreadPlacement::Scatter, 1), std::vector<int>{6});
+
+    // Without sysfs, every allowed CPU is a core of its own
+    std::filesystem::remove_all(root);
+    const CpuTopology unknown(root.string(), {0, 1});
+    EXPECT_EQ(unknown.nbCores(), 2u);
+    EXPECT_EQ(unknown.nbNodes(), 1u);
+    EXPECT_EQ(unknown.cpusFor(ThreadPlacement::Compact, 1), std::vector<int>{1});
+}